@@ -1,3 +1,3 @@
-windres ogg-winmm.rc.in -O coff -o ogg-winmm.rc.o
-gcc -std=gnu99 -Wl,--enable-stdcall-fixup -Ilibs/include -O2 -shared -s -o ogg-winmm.dll ogg-winmm.c player.c stubs.c ogg-winmm.def ogg-winmm.rc.o -L. -lvorbisfile -lwinmm -D_DEBUG -static-libgcc
+windres ogg-winmm.rc.in -O coff -o ogg-winmm.rc.o
+gcc -std=gnu99 -Wl,--enable-stdcall-fixup -Ilibs/include -O2 -shared -s -o ogg-winmm.dll ogg-winmm.c core.c catalog.c cue.c pack.c seek.c loudness.c playlist.c layout.c player.c sink_waveout.c os_win32.c stubs.c trace.c notify.c stats.c log.c mixer.c mixkernel.c ogg-winmm.def ogg-winmm.rc.o -L. -lvorbisfile -lwinmm -D_DEBUG -static-libgcc
 pause
\ No newline at end of file
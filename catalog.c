@@ -0,0 +1,631 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "cdtime.h"
+#include "os.h"
+#include "player.h"
+#include "cue.h"
+#include "pack.h"
+#include "catalog.h"
+#include "log.h"
+
+/* The track catalog. It is built from one listing of the music folder and,
+ * once catalog_watch() runs, kept up to date from change notifications:
+ * only the files that changed are opened again and the positions are
+ * recomputed from the first track that moved.
+ *
+ * Readers pin the current catalog with catalog_get() and never wait.
+ * Updates build a new catalog on the side and swap the pointer. Replaced
+ * catalogs go on a retired list, which is freed by the first update that
+ * finds no reader pinned. A reader pins before it loads the pointer, so it
+ * either holds the new catalog or is counted. */
+
+#define MAX_FOLDER_TRACKS 255   /* TMSF has a byte for the track */
+
+/* tracks without a file are data tracks of this length */
+#define DATA_TRACK_FRAMES (4 * CD_FPS)
+
+/* a burst of changes, like a file being copied in, is waited out first */
+#define WATCH_QUIET_MS 500
+
+/* how often an idle watcher looks at watch_stop */
+#define WATCH_POLL_MS 100
+
+static struct catalog *volatile catalog = NULL;
+static volatile LONG catalog_readers = 0;
+static os_mutex catalog_lock = NULL;            /* updates, readers never take it */
+
+static char scan_path[MAX_PATH];
+static int scan_mode = CATALOG_CD;
+static int scan_packed = 0;                     /* CD mode from music.pak */
+
+static os_thread watch_thread = NULL;
+static volatile LONG watch_stop = 0;
+
+struct scan_list
+{
+    char **names;
+    int count;
+    int cap;
+    const char *ext;        /* names kept, NULL for tracks and sheets */
+};
+
+void catalog_init()
+{
+    catalog_lock = os_mutex_create();
+}
+
+const struct catalog *catalog_get()
+{
+    os_add(&catalog_readers, 1);
+    return catalog;
+}
+
+void catalog_put()
+{
+    os_add(&catalog_readers, -1);
+}
+
+/* makes c current, called with catalog_lock held */
+static void catalog_publish(struct catalog *c)
+{
+    struct catalog *old;
+
+    /* the old one carries the ones retired before it */
+    c->retired = os_xchg(&catalog, c);
+
+    if (catalog_readers == 0)
+    {
+        while ((old = c->retired))
+        {
+            c->retired = old->retired;
+            free(old);
+        }
+    }
+}
+
+static struct catalog *catalog_alloc(int slots)
+{
+    struct catalog *c = calloc(1, sizeof *c + slots * sizeof *c->tracks);
+
+    c->slots = slots;
+    return c;
+}
+
+static void scan_add(void *ctx, const char *name)
+{
+    struct scan_list *l = ctx;
+    size_t len = strlen(name);
+    const char *ext = len > 4 ? name + len - 4 : "";
+    int i;
+
+    if (l->ext ? strcasecmp(ext, l->ext) : strcasecmp(ext, ".ogg") && strcasecmp(ext, ".cue"))
+        return;
+
+    /* change notifications repeat names */
+    for (i = 0; i < l->count; i++)
+    {
+        if (!strcmp(l->names[i], name))
+            return;
+    }
+
+    if (l->count == l->cap)
+    {
+        l->cap = l->cap ? l->cap * 2 : 64;
+        l->names = realloc(l->names, l->cap * sizeof *l->names);
+    }
+
+    l->names[l->count++] = strdup(name);
+}
+
+static void scan_free(struct scan_list *l)
+{
+    int i;
+
+    for (i = 0; i < l->count; i++)
+        free(l->names[i]);
+
+    free(l->names);
+    l->names = NULL;
+    l->count = l->cap = 0;
+}
+
+static int scan_cmp(const void *a, const void *b)
+{
+    return strcasecmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* CD mode track number of "NN.ogg" or "TrackNN.ogg", 0 for other names */
+static int scan_number(const char *name)
+{
+    if (!strncasecmp(name, "track", 5))
+        name += 5;
+
+    if (!isdigit((unsigned char)name[0]) || !isdigit((unsigned char)name[1]) || strcasecmp(name + 2, ".ogg"))
+        return 0;
+
+    return (name[0] - '0') * 10 + name[1] - '0';
+}
+
+static int scan_has(const struct scan_list *l, const char *name)
+{
+    int i;
+
+    for (i = 0; l && i < l->count; i++)
+    {
+        if (!strcmp(l->names[i], name))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* the full path of a file in the music folder, empty if it doesn't fit so
+ * a cut off name is never opened */
+static void scan_file(char *path, const char *name)
+{
+    int n = snprintf(path, MAX_PATH, "%s" OS_PATH_SEP "%s", scan_path, name);
+
+    if (n < 0 || n >= MAX_PATH)
+    {
+        lprintf(LOG_WARN, "Path of %s is too long\r\n", name);
+        path[0] = '\0';
+    }
+}
+
+/* frames from samples, tracks under 4 seconds or that can't be played
+ * become data tracks */
+static void track_fit(struct track_info *t)
+{
+    if (!t->rate || t->samples < 4 * (int64_t)t->rate)
+    {
+        t->path[0] = '\0';
+        t->samples = t->rate = 0;
+        t->frames = DATA_TRACK_FRAMES; /* missing tracks are data tracks for us */
+        return;
+    }
+
+    /* a partial frame at the end still counts */
+    t->frames = cd_samples_to_frames(t->samples, t->rate);
+    if (cd_frames_to_samples(t->frames, t->rate) < t->samples)
+        t->frames++;
+}
+
+/* opens the track's file for its length */
+static void track_probe(struct track_info *t)
+{
+    t->offset = 0;
+    t->samples = t->path[0] ? plr_length(t->path, &t->rate) : 0;
+
+    if (t->path[0] && !t->rate)
+        lprintf(LOG_WARN, "Can't open %s, it becomes a data track\r\n", t->path);
+
+    track_fit(t);
+}
+
+/* positions from track 'from' on, then the track numbers; no file access */
+static void catalog_layout(struct catalog *c, int from)
+{
+    struct track_info *t = c->tracks;
+    uint32_t start = from > 1 ? t[from - 1].start + t[from - 1].frames : CD_LEADIN;
+    int i;
+
+    for (i = from > 1 ? from : 1; i < c->slots; i++)
+    {
+        t[i].start = start;
+        start += t[i].frames;
+    }
+
+    c->firstTrack = -1;
+    c->lastTrack = 0;
+    c->numTracks = 1;
+
+    for (i = 1; i < c->slots; i++)
+    {
+        if (!t[i].path[0])
+            continue;
+
+        if (c->firstTrack == -1)
+            c->firstTrack = i;
+        if(i == c->numTracks) c->numTracks -= 1; /* Take into account pure music cd's starting with track01.ogg */
+
+        c->numTracks++;
+        c->lastTrack = i;
+    }
+}
+
+/* the old entry for path if its file is not in 'changed', NULL otherwise */
+static const struct track_info *track_reuse(const struct catalog *old, const char *path, const struct scan_list *changed)
+{
+    const char *name = path + strlen(scan_path) + 1;
+    int i;
+
+    if (!old || !changed || scan_has(changed, name))
+        return NULL;
+
+    for (i = 1; i < old->slots; i++)
+    {
+        if (!strcmp(old->tracks[i].path, path))
+            return &old->tracks[i];
+    }
+
+    return NULL;
+}
+
+/* Disc image mode: the first .cue in the folder lays out the tracks, all
+ * of them usually in one file. Every file the sheet names is opened once. */
+static struct catalog *catalog_image()
+{
+    static struct cue_track cue[CUE_MAX_TRACKS];
+    struct scan_list l = { NULL, 0, 0, ".cue" };
+    struct catalog *c;
+    char sheet[MAX_PATH], file[MAX_PATH] = "";
+    int64_t length = 0;
+    int i, count = 0, slots = 2, rate = 0;
+
+    os_list_dir(scan_path, scan_add, &l);
+    if (l.count)
+    {
+        qsort(l.names, l.count, sizeof *l.names, scan_cmp);
+        scan_file(sheet, l.names[0]);
+        count = sheet[0] ? cue_read(sheet, cue, CUE_MAX_TRACKS) : 0;
+
+        if (count)
+            dprintf("Disc image %s, %d tracks\r\n", sheet, count);
+        else
+            lprintf(LOG_ERROR, "Disc image %s has no tracks\r\n", sheet);
+    }
+
+    scan_free(&l);
+
+    for (i = 0; i < count; i++)
+    {
+        if (cue[i].number >= slots)
+            slots = cue[i].number + 1;
+    }
+
+    c = catalog_alloc(slots);
+
+    for (i = 1; i < slots; i++)
+        c->tracks[i].frames = DATA_TRACK_FRAMES;
+
+    for (i = 0; i < count; i++)
+    {
+        struct track_info *t = &c->tracks[cue[i].number];
+
+        if (!cue[i].audio)
+            continue;
+
+        if (strcmp(file, cue[i].file))
+        {
+            strcpy(file, cue[i].file);
+            length = plr_length(file, &rate);
+
+            if (!rate)
+                lprintf(LOG_ERROR, "Can't open %s of the disc image\r\n", file);
+        }
+
+        if (!rate)
+            continue;
+
+        /* up to the next track in the same file, its pregap included */
+        strcpy(t->path, file);
+        t->rate = rate;
+        t->offset = cd_frames_to_samples(cue[i].index, rate);
+        t->samples = (i + 1 < count && !strcmp(cue[i + 1].file, file) ? cd_frames_to_samples(cue[i + 1].index, rate) : length) - t->offset;
+
+        track_fit(t);
+    }
+
+    catalog_layout(c, 1);
+    return c;
+}
+
+/* CD mode from the index of music.pak, no stream is opened */
+static struct catalog *catalog_pack(const char *pack)
+{
+    const struct pack_entry *e;
+    struct catalog *c;
+    int i, count = pack_index(&e), slots = 2;
+
+    for (i = 0; i < count; i++)
+    {
+        if (e[i].track < 100 && e[i].track >= slots)
+            slots = e[i].track + 1;
+    }
+
+    c = catalog_alloc(slots);
+
+    for (i = 1; i < slots; i++)
+        c->tracks[i].frames = DATA_TRACK_FRAMES;
+
+    for (i = 0; i < count; i++)
+    {
+        struct track_info *t = &c->tracks[e[i].track];
+
+        if (e[i].track < 1 || e[i].track >= slots)
+            continue;
+
+        /* stays a data track rather than naming the wrong stream */
+        if (snprintf(t->path, sizeof t->path, "%s#%02u", pack, (unsigned)e[i].track) >= sizeof t->path)
+        {
+            t->path[0] = '\0';
+            continue;
+        }
+
+        t->rate = e[i].rate;
+        t->samples = e[i].samples;
+        track_fit(t);
+    }
+
+    catalog_layout(c, 1);
+    return c;
+}
+
+/* Lists the folder and builds a new catalog. Entries of 'old' whose files
+ * are not in 'changed' are copied instead of opened again; with no list
+ * every file is opened. Called with catalog_lock held. */
+static struct catalog *catalog_build(const struct catalog *old, const struct scan_list *changed)
+{
+    struct scan_list l = { NULL, 0, 0, ".ogg" };
+    struct catalog *c;
+    char pack[MAX_PATH];
+    int i, slots = 2, moved;
+
+    if (scan_mode == CATALOG_IMAGE)
+        return catalog_image();
+
+    /* the archive takes the place of the loose files */
+    scan_file(pack, PACK_NAME);
+    scan_packed = scan_mode == CATALOG_CD && pack[0] && pack_open(pack);
+
+    if (scan_packed)
+        return catalog_pack(pack);
+
+    os_list_dir(scan_path, scan_add, &l);
+    if (l.count)
+        qsort(l.names, l.count, sizeof *l.names, scan_cmp);
+
+    if (scan_mode == CATALOG_FOLDER)
+    {
+        if (l.count > MAX_FOLDER_TRACKS - 1)
+            l.count = MAX_FOLDER_TRACKS - 1;
+
+        slots += l.count;
+    }
+    else
+    {
+        for (i = 0; i < l.count; i++)
+        {
+            int n = scan_number(l.names[i]);
+
+            if (n >= slots)
+                slots = n + 1;
+        }
+    }
+
+    c = catalog_alloc(slots);
+
+    for (i = 0; i < l.count; i++)
+    {
+        int n = scan_mode == CATALOG_FOLDER ? i + 2 : scan_number(l.names[i]);
+
+        /* "Changed: int i = 0" to "1" we can skip track00.ogg" */
+        if (n > 0)
+            scan_file(c->tracks[n].path, l.names[i]);
+    }
+
+    scan_free(&l);
+
+    moved = slots;
+
+    for (i = 1; i < slots; i++)
+    {
+        struct track_info *t = &c->tracks[i];
+        const struct track_info *prev = track_reuse(old, t->path, changed);
+
+        if (prev)
+            *t = *prev;
+        else
+            track_probe(t);
+
+        /* everything after the first difference moves */
+        if (moved == slots && (!old || i >= old->slots || t->frames != old->tracks[i].frames))
+            moved = i;
+    }
+
+    /* the tracks before it are as long as before, so are where they were */
+    for (i = 1; i < moved; i++)
+        c->tracks[i].start = old->tracks[i].start;
+
+    catalog_layout(c, moved);
+
+    dprintf("Catalog rebuilt, positions moved from track %d\r\n", moved);
+    return c;
+}
+
+/* CD mode: only the changed numbers are opened again. Called with
+ * catalog_lock held. */
+static struct catalog *catalog_patch(const struct catalog *old, const struct scan_list *changed)
+{
+    struct catalog *c;
+    int i, slots = old->slots, moved = slots;
+
+    for (i = 0; i < changed->count; i++)
+    {
+        int n = scan_number(changed->names[i]);
+
+        if (n >= slots)
+            slots = n + 1;
+    }
+
+    c = catalog_alloc(slots);
+    memcpy(c->tracks, old->tracks, old->slots * sizeof *c->tracks);
+
+    for (i = old->slots; i < slots; i++)
+        c->tracks[i].frames = DATA_TRACK_FRAMES;
+
+    for (i = 0; i < changed->count; i++)
+    {
+        int n = scan_number(changed->names[i]);
+        struct track_info *t = &c->tracks[n];
+
+        if (!n)
+            continue;
+
+        scan_file(t->path, changed->names[i]);
+        track_probe(t);
+
+        dprintf("Track %02d: %u frames, %s\r\n", n, t->frames, t->path[0] ? t->path : "data");
+
+        if (n < moved)
+            moved = n;
+    }
+
+    /* new slots past the old end need their positions too */
+    if (old->slots < moved)
+        moved = old->slots;
+
+    catalog_layout(c, moved);
+    return c;
+}
+
+/* Builds the catalog from one listing of music_path. In CD mode the files
+ * are NN.ogg and give their own track numbers, in folder mode every .ogg is
+ * a track in name order from track 2 on, after a data track like on a
+ * mixed mode CD, and in image mode a CUE sheet splits one file into the
+ * tracks. Returns the number of audio tracks. */
+int catalog_scan(const char *music_path, int mode)
+{
+    struct catalog *c;
+    int i, audio = 0;
+
+    os_mutex_lock(catalog_lock);
+
+    snprintf(scan_path, sizeof scan_path, "%s", music_path);
+    scan_mode = mode;
+
+    c = catalog_build(NULL, NULL);
+
+    for (i = 1; i < c->slots; i++)
+    {
+        if (c->tracks[i].path[0])
+        {
+            dprintf("Track %02d: %u frames @ %u, %s\r\n", i, c->tracks[i].frames, c->tracks[i].start, c->tracks[i].path);
+            audio++;
+        }
+    }
+
+    dprintf("Emulating total of %d CD tracks.\r\n\r\n", c->numTracks);
+
+    catalog_publish(c);
+    os_mutex_unlock(catalog_lock);
+
+    return audio;
+}
+
+/* changed is NULL when the notifications were lost */
+static void catalog_update(const struct scan_list *changed)
+{
+    const struct catalog *old;
+    struct catalog *c;
+
+    os_mutex_lock(catalog_lock);
+
+    /* the archive stays mapped, a new one is read on the next start */
+    if (scan_packed)
+    {
+        os_mutex_unlock(catalog_lock);
+        return;
+    }
+
+    old = catalog;
+
+    /* adding or removing a file renumbers everything after it in folder
+     * mode, disc images are laid out again from the sheet */
+    if (scan_mode != CATALOG_CD || !changed || !old)
+        c = catalog_build(old, changed);
+    else
+        c = catalog_patch(old, changed);
+
+    catalog_publish(c);
+    os_mutex_unlock(catalog_lock);
+}
+
+static int catalog_watch_main(void *arg)
+{
+    os_watch w = arg;
+    struct scan_list changed = { NULL, 0, 0, NULL };
+    char name[MAX_PATH];
+    int lost = 0;
+
+    while (!watch_stop)
+    {
+        int pending = changed.count || lost;
+        int r = os_watch_next(w, name, sizeof name, pending ? WATCH_QUIET_MS : WATCH_POLL_MS);
+
+        if (r < 0)
+            break;
+
+        if (r > 0)
+        {
+            if (!name[0])
+                lost = 1;
+            else
+                scan_add(&changed, name);
+            continue;
+        }
+
+        if (pending)
+        {
+            dprintf("Music folder changed, %d files%s\r\n", changed.count, lost ? " and lost notifications" : "");
+
+            catalog_update(lost ? NULL : &changed);
+            scan_free(&changed);
+            lost = 0;
+        }
+    }
+
+    scan_free(&changed);
+    os_watch_close(w);
+    return 0;
+}
+
+/* starts following changes to the folder of the last catalog_scan() */
+int catalog_watch()
+{
+    os_watch w;
+
+    if (watch_thread)
+        return 1;
+
+    w = os_watch_open(scan_path);
+
+    if (!w)
+        return 0;
+
+    watch_stop = 0;
+    watch_thread = os_thread_start(catalog_watch_main, w, 0);
+
+    return watch_thread != NULL;
+}
+
+/* Stops following changes. With wait it returns once the watcher has
+ * exited, which takes up to WATCH_QUIET_MS; without, the watcher is only
+ * told to stop, for DllMain, which must never wait on a thread. */
+void catalog_unwatch(int wait)
+{
+    if (!watch_thread)
+        return;
+
+    os_xchg(&watch_stop, 1);
+
+    if (wait)
+        os_thread_join(watch_thread);
+    else
+        os_thread_detach(watch_thread);
+
+    watch_thread = NULL;
+}
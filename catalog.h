@@ -0,0 +1,47 @@
+/* The virtual disc the core plays from, see catalog.c */
+
+#include <stdint.h>
+#include "mcidefs.h"
+
+/* PlaybackMode, where the tracks come from */
+enum
+{
+    CATALOG_CD,             /* NN.ogg or TrackNN.ogg */
+    CATALOG_FOLDER,         /* every .ogg in name order */
+    CATALOG_IMAGE           /* one .ogg laid out by a .cue */
+};
+
+/* Positions are CD frames from the start of the disc, track 1 starting
+ * after the lead-in like on a real one, and each track keeps its exact
+ * length in samples for play ranges. */
+struct track_info
+{
+    char path[MAX_PATH];    /* full path to ogg, empty for data tracks */
+    uint32_t start;         /* CD frames */
+    uint32_t frames;        /* length in CD frames, the last one partial */
+    int64_t offset;         /* first sample in the file, 0 but in disc images */
+    int64_t samples;        /* length in samples at rate */
+    int rate;
+};
+
+/* Track numbers index tracks[] directly, so slot 0 and the data tracks are
+ * there but empty. A published catalog never changes, updates publish a
+ * new one. */
+struct catalog
+{
+    struct catalog *retired;    /* older catalogs not freed yet */
+    int slots;
+    int firstTrack;             /* -1 without audio tracks */
+    int lastTrack;
+    int numTracks;              /* +1 for data track on mixed mode cd's */
+    struct track_info tracks[];
+};
+
+void catalog_init();
+int catalog_scan(const char *music_path, int mode);
+int catalog_watch();
+void catalog_unwatch(int wait);
+
+/* the current catalog, valid until catalog_put(); never blocks */
+const struct catalog *catalog_get();
+void catalog_put();
@@ -0,0 +1,56 @@
+/* CD time arithmetic. The catalog in catalog.c counts CD frames, 1/75 s, from
+ * the start of the disc; these convert between frames and the MCI time
+ * formats and sample offsets. All are plain arithmetic without branches,
+ * the divisions are by constants and compile to multiplies. */
+
+#include <stdint.h>
+
+#define CD_FPS      75
+#define CD_LEADIN   150         /* track 1 starts 2 seconds into the disc */
+
+/* rounded down; frames -> ms -> frames gives back the same frame */
+static inline uint32_t cd_ms_to_frames(uint32_t ms)
+{
+    return (uint32_t)((uint64_t)ms * CD_FPS / 1000);
+}
+
+/* rounded up so that cd_ms_to_frames() lands on the same frame */
+static inline uint32_t cd_frames_to_ms(uint32_t frames)
+{
+    return (uint32_t)(((uint64_t)frames * 1000 + CD_FPS - 1) / CD_FPS);
+}
+
+/* MSF as packed by MCI_MAKE_MSF, minutes wrap at 256 */
+static inline uint32_t cd_frames_to_msf(uint32_t frames)
+{
+    return (frames / (60 * CD_FPS) & 0xFF) | (frames / CD_FPS % 60) << 8 | (frames % CD_FPS) << 16;
+}
+
+static inline uint32_t cd_msf_to_frames(uint32_t msf)
+{
+    return (msf & 0xFF) * 60 * CD_FPS + (msf >> 8 & 0xFF) * CD_FPS + (msf >> 16 & 0xFF);
+}
+
+/* TMSF as packed by MCI_MAKE_TMSF, the offset is from the start of the track */
+static inline uint32_t cd_tmsf(uint32_t track, uint32_t offset)
+{
+    return (track & 0xFF) | cd_frames_to_msf(offset) << 8;
+}
+
+static inline uint32_t cd_tmsf_offset(uint32_t tmsf)
+{
+    return cd_msf_to_frames(tmsf >> 8);
+}
+
+/* the first sample of the frame, exact for the usual rates, which are all
+ * multiples of 75, and rounded up for the others */
+static inline int64_t cd_frames_to_samples(uint32_t frames, int rate)
+{
+    return ((int64_t)frames * rate + CD_FPS - 1) / CD_FPS;
+}
+
+/* rounded down, the frame the sample is in */
+static inline uint32_t cd_samples_to_frames(int64_t samples, int rate)
+{
+    return (uint32_t)(samples * CD_FPS / rate);
+}
@@ -0,0 +1,959 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "cdtime.h"
+#include "os.h"
+#include "player.h"
+#include "playlist.h"
+#include "stats.h"
+#include "catalog.h"
+#include "core.h"
+#include "log.h"
+
+/* The emulated cdaudio device: time formats, the MCI command and string
+ * handlers and the player thread, playing from the catalog in catalog.c.
+ * Nothing here calls Win32, the DLL hosts it from ogg-winmm.c and the native
+ * tools run it on sink_sim.c.
+ *
+ * The catalog may be replaced at any time by the folder watcher, so every
+ * command works on the one it pinned at its start and the player thread
+ * pins one per track. */
+
+/* tracks first to last, from and to are CD frames into the first and last
+ * track, to is 0 for the end of the track */
+struct play_info
+{
+    int first;
+    int last;
+    uint32_t from;
+    uint32_t to;
+};
+
+/* Device state machine. The game thread makes every transition except
+ * PLAYING -> STOPPED at the end of the requested range, which the player
+ * thread makes itself. All transitions are atomic and each one signals
+ * state_ev, so the player thread sleeps instead of polling while paused.
+ *
+ *   CLOSED  --open-->   STOPPED
+ *   STOPPED --play-->   PLAYING --pause-->  PAUSED --resume--> PLAYING
+ *   PLAYING/PAUSED --stop/close/end of range--> STOPPED/CLOSED
+ */
+enum
+{
+    STATE_CLOSED,
+    STATE_STOPPED,
+    STATE_PLAYING,
+    STATE_PAUSED
+};
+
+static volatile LONG state = STATE_STOPPED;
+static os_event state_ev = NULL;
+
+/* Commands from several game threads run one at a time, so only the player
+ * thread races with them. It never takes the lock. */
+static os_mutex command_lock = NULL;
+
+/* window waiting for the current play command to finish, NULL if none */
+static HWND volatile notify_hwnd = NULL;
+
+static struct core_host host;
+
+int current  = 1;
+static os_thread player = NULL;
+int time_format = MCI_FORMAT_TMSF;
+char alias_s[100] = "cdaudio";
+static struct play_info info = { -1, -1, 0, 0 };
+static volatile LONG stop_position = CD_LEADIN;    /* while not playing */
+
+/* The track of each range the player started, by range number. The range
+ * before the last one is still heard while the end of it drains, so both
+ * are kept. */
+static volatile LONG range_track[2];
+
+/* loop points in samples into the track, set from the config; length 0 for
+ * none, then the LOOPSTART/LOOPLENGTH tags are used if loop_tags is on */
+static struct { int64_t start, length; } loops[100];
+static int loop_tags = 0;
+
+/* other orders than the CD's only make sense without one */
+static int folder_mode = 0;
+
+/* core_watch() was called, the watcher runs while the device is open */
+static int watch_music = 0;
+
+/* unconditional transition, returns the previous state */
+static LONG state_set(LONG to)
+{
+    LONG from = os_xchg(&state, to);
+    os_event_set(state_ev);
+    return from;
+}
+
+/* transition only if the device is still in 'from' */
+static int state_move(LONG from, LONG to)
+{
+    if (os_cas(&state, from, to) != from)
+        return 0;
+
+    os_event_set(state_ev);
+    return 1;
+}
+
+/* Sets up the loop of the track just opened, if it has one that lies within
+ * the range being played. Overrides are in samples into the track, tags in
+ * samples into the file. */
+static void loop_track(int track, int64_t from, int64_t to, int64_t offset, int64_t samples)
+{
+    int64_t start = loops[track].start, length = loops[track].length;
+
+    if (length > 0)
+    {
+        if (start + length > samples)
+            return;
+
+        start += offset;
+    }
+    else if (!loop_tags || !plr_loop_tags(&start, &length))
+    {
+        return;
+    }
+
+    if (start < offset || start + length > to || start + length <= from)
+        return;
+
+    dprintf("  Looping track %d at %ld+%ld\r\n", track, (long)(start - offset), (long)length);
+    plr_loop(start, start + length);
+}
+
+static int player_main(void *arg)
+{
+    struct play_info *info = arg;
+    int first = info->first;
+    int last = info->last;
+    int played = 0, next;
+    dprintf("OGG Player logic: %d to %d\r\n", first, last);
+
+    playlist_start(catalog_get(), first, last, !folder_mode);
+    catalog_put();
+    current = playlist_next();
+
+    /* don't open the next track once a stop has been requested */
+    while (current && (state == STATE_PLAYING || state == STATE_PAUSED))
+    {
+        /* the track as the catalog has it now, it may have changed since play */
+        const struct catalog *cat = catalog_get();
+        char path[MAX_PATH] = "", next_path[MAX_PATH] = "";
+        int64_t from = 0, to = 0, offset = 0, samples = 0;
+
+        next = playlist_peek();
+
+        if (current < cat->slots)
+        {
+            const struct track_info *t = &cat->tracks[current];
+
+            strcpy(path, t->path);
+            /* tracks of a disc image are ranges of the same file */
+            from = t->offset + (!played ? cd_frames_to_samples(info->from, t->rate) : 0);
+            to = t->offset + (current == last && info->to ? cd_frames_to_samples(info->to, t->rate) : t->samples);
+            offset = t->offset;
+            samples = t->samples;
+        }
+
+        if (next && next < cat->slots)
+            strcpy(next_path, cat->tracks[next].path);
+
+        catalog_put();
+
+        dprintf("Next track: %s\r\n", path);
+
+        uint64_t t0 = stat_ticks();
+        int underruns_before, underruns, latency;
+
+        plr_stats(&latency, &underruns_before);
+
+        /* the range this starts, heard once the last one drained */
+        range_track[(plr_range() + 1) & 1] = current;
+
+        /* data tracks have no file and are skipped like on a CD */
+        if (!plr_play(path, from, to) && path[0])
+            lprintf(LOG_ERROR, "  Can't play %s\r\n", path);
+
+        stat_record(HIST_OPEN_US, stat_us(stat_ticks() - t0));
+        stat_inc(STAT_TRACKS);
+
+        /* only the last track can loop, the ones before it have to end */
+        if (!next)
+            loop_track(current, from, to, offset, samples);
+        else
+            plr_preload(next_path);
+
+        while (1)
+        {
+            LONG s = state;
+
+            if (s == STATE_PAUSED)
+            {
+                /* The game thread already paused the device, this covers a
+                 * pause that landed while we were switching tracks. The
+                 * decoder stays where it is until resume, stop or close. */
+                plr_pause();
+                os_event_wait(state_ev, -1);
+                if (state == STATE_PLAYING)
+                    plr_resume();
+                continue;
+            }
+
+            if (s != STATE_PLAYING)
+            {
+                plr_stop();
+                return 0;
+            }
+
+            if (plr_pump() == 0)
+                break;
+        }
+
+        plr_stats(&latency, &underruns);
+
+        if (underruns > underruns_before)
+            lprintf(LOG_WARN, "  %d underruns in %s, output queue now %d ms\r\n", underruns - underruns_before, path, latency);
+        else
+            dprintf("  Output queue %d ms, %d underruns so far\r\n", latency, underruns);
+
+        played++;
+        current = playlist_next();
+    }
+
+    plr_stop();
+
+    const struct catalog *cat = catalog_get();
+    if (last < cat->slots)
+        stop_position = cat->tracks[last].start + (info->to ? info->to : cat->tracks[last].frames);
+    catalog_put();
+
+    /* a pause that came after the last block holds the end back until
+     * resume, stop or close */
+    while (state == STATE_PAUSED)
+        os_event_wait(state_ev, -1);
+
+    /* the game may have stopped us in the meantime */
+    if (!state_move(STATE_PLAYING, STATE_STOPPED))
+        return 0;
+
+    HWND hwnd = os_xchg(&notify_hwnd, NULL);
+    if (hwnd)
+    {
+        dprintf("  Sending MCI_NOTIFY_SUCCESSFUL message...\r\n");
+        host.notify(hwnd, MCI_NOTIFY_SUCCESSFUL);
+        /* NOTE: Notify message after successful playback is not working in Vista+.
+        MCI_STATUS_MODE does not update to show that the track is no longer playing.
+        Bug or broken design in mcicda.dll (also noted by the Wine team) */
+    }
+
+    return 0;
+}
+
+/* disc frame the player is heard at, stop_position outside of any track */
+static uint32_t heard_frame(const struct catalog *cat)
+{
+    int range;
+    int64_t pos = plr_tell(&range);
+    int t = range_track[range & 1];
+
+    if (t < 1 || t >= cat->slots || !cat->tracks[t].rate)
+        return stop_position;
+
+    return cat->tracks[t].start + cd_samples_to_frames(pos - cat->tracks[t].offset, cat->tracks[t].rate);
+}
+
+/* Moves the device out of PLAYING/PAUSED and waits for the player thread to
+ * close the wave device. The thread notices within one ov_read() chunk. */
+static void player_join(LONG to)
+{
+    LONG from = state_set(to);
+    uint64_t t0;
+
+    if (!player)
+        return;
+
+    t0 = stat_ticks();
+
+    /* interrupt the decode and any wait for a device buffer */
+    if (from == STATE_PLAYING || from == STATE_PAUSED)
+    {
+        stop_position = heard_frame(catalog_get());
+        catalog_put();
+        plr_cancel();
+    }
+
+    /* the thread never blocks on the game, notifications are posted */
+    os_thread_join(player);
+    player = NULL;
+
+    dprintf("  Player stopped in %u us\r\n", stat_us(stat_ticks() - t0));
+}
+
+/* Replaces the pending play notification. The previous one is superseded by
+ * a new command that wants a notification and aborted by anything else. */
+static void notify_replace(HWND hwnd, WPARAM status)
+{
+    HWND prev = os_xchg(&notify_hwnd, hwnd);
+
+    if (prev)
+        host.notify(prev, status);
+}
+
+/* callback window of a command, broadcast when the game did not give one */
+static HWND notify_target(DWORD_PTR dwParam)
+{
+    HWND hwnd = dwParam ? (HWND)((MCI_GENERIC_PARMS *)dwParam)->dwCallback : NULL;
+    return hwnd ? hwnd : (HWND)0xffff;
+}
+
+/* track holding the given disc frame, the first one for the lead-in and
+ * the empty slot 0 without audio tracks */
+static int track_at(const struct catalog *cat, uint32_t frame)
+{
+    int i;
+
+    for (i = cat->lastTrack; i > cat->firstTrack && i > 0; i--)
+    {
+        if (cat->tracks[i].path[0] && cat->tracks[i].start <= frame)
+            break;
+    }
+
+    return i;
+}
+
+/* position in the current time format -> disc frame */
+static uint32_t frame_of(const struct catalog *cat, DWORD pos)
+{
+    if (time_format == MCI_FORMAT_TMSF)
+    {
+        int t = MCI_TMSF_TRACK(pos);
+
+        if (t < 1 || t > cat->lastTrack)
+            t = t < 1 && cat->firstTrack > 0 ? cat->firstTrack : cat->lastTrack;
+
+        return cat->tracks[t].start + cd_tmsf_offset(pos);
+    }
+
+    if (time_format == MCI_FORMAT_MSF)
+        return cd_msf_to_frames(pos);
+
+    return cd_ms_to_frames(pos);
+}
+
+/* disc frame -> position in the current time format */
+static DWORD position_of(const struct catalog *cat, uint32_t frame)
+{
+    if (time_format == MCI_FORMAT_TMSF)
+    {
+        int t = track_at(cat, frame);
+        return cd_tmsf(t, frame > cat->tracks[t].start ? frame - cat->tracks[t].start : 0);
+    }
+
+    if (time_format == MCI_FORMAT_MSF)
+        return cd_frames_to_msf(frame);
+
+    return cd_frames_to_ms(frame);
+}
+
+/* lengths are MSF in the TMSF format, there is no track to give */
+static DWORD length_of(uint32_t frames)
+{
+    return time_format == MCI_FORMAT_MILLISECONDS ? cd_frames_to_ms(frames) : cd_frames_to_msf(frames);
+}
+
+/* disc frame being heard now */
+static uint32_t current_frame(const struct catalog *cat)
+{
+    LONG s = state;
+
+    if (s != STATE_PLAYING && s != STATE_PAUSED)
+        return stop_position;
+
+    return heard_frame(cat);
+}
+
+void core_init(const struct core_host *h)
+{
+    host = *h;
+    state_ev = os_event_create(0);
+    command_lock = os_mutex_create();
+    catalog_init();
+}
+
+/* Builds the catalog from one listing of music_path, see catalog_scan().
+ * Returns the number of audio tracks. */
+int core_scan(const char *music_path, int mode)
+{
+    int audio = catalog_scan(music_path, mode);
+
+    folder_mode = mode == CATALOG_FOLDER;
+    const struct catalog *cat = catalog_get();
+
+    if (cat->firstTrack != -1)
+        stop_position = cat->tracks[cat->firstTrack].start;
+
+    if (current >= cat->slots)
+        current = 1;
+
+    catalog_put();
+    return audio;
+}
+
+/* Loops samples [start, start + length) of a track once playback gets to
+ * its end, if the track is the last one played. length 0 removes it. */
+void core_loop(int track, int64_t start, int64_t length)
+{
+    if (track < 1 || track >= (int)(sizeof loops / sizeof loops[0]) || start < 0 || length < 0)
+        return;
+
+    loops[track].start = start;
+    loops[track].length = length;
+}
+
+/* honour LOOPSTART/LOOPLENGTH tags of tracks without an override */
+void core_loop_tags(int on)
+{
+    loop_tags = on;
+}
+
+/* Follows changes to the music folder from now on. MCI_CLOSE stops the
+ * watcher, on the game thread where it can be waited for, and MCI_OPEN
+ * starts it again. */
+int core_watch()
+{
+    watch_music = 1;
+    return catalog_watch();
+}
+
+/* see catalog_unwatch() for wait */
+void core_unwatch(int wait)
+{
+    watch_music = 0;
+    catalog_unwatch(wait);
+}
+
+static MCIERROR mci_command(const struct catalog *cat, MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam)
+{
+    dprintf("mciSendCommandA(IDDevice=%d, uMsg=%08X, fdwCommand=%08X, dwParam=%p)\r\n", (int)IDDevice, uMsg, (unsigned)fdwCommand, (void *)dwParam);
+
+    if (uMsg == MCI_OPEN)
+    {
+        state_move(STATE_CLOSED, STATE_STOPPED);
+
+        if (watch_music)
+            catalog_watch();
+
+        if (dwParam)
+            ((MCI_OPEN_PARMS *)dwParam)->wDeviceID = MAGIC_DEVICEID;
+
+        return 0;
+    }
+	else
+    if (uMsg == MCI_SET)
+    {
+        if ((fdwCommand & MCI_SET_TIME_FORMAT) && dwParam)
+        {
+            time_format = ((MCI_SET_PARMS *)dwParam)->dwTimeFormat;
+            dprintf("  Time format is now %d\r\n", time_format);
+        }
+
+        return 0;
+	}
+	else
+    if (uMsg == MCI_CLOSE)
+    {
+        player_join(STATE_CLOSED);
+        notify_replace(NULL, MCI_NOTIFY_ABORTED);
+        catalog_unwatch(1);
+        return 0;
+    }
+	else
+    if (uMsg == MCI_PLAY)
+    {
+        MCI_PLAY_PARMS *parms = (MCI_PLAY_PARMS *)dwParam;
+
+        /* no disc to play, like a drive without one */
+        if (cat->firstTrack < 1)
+            return MCIERR_DEVICE_NOT_READY;
+
+        player_join(STATE_STOPPED);
+
+        int t = current < cat->slots ? current : 1;
+        uint32_t from = (fdwCommand & MCI_FROM) && parms ? frame_of(cat, parms->dwFrom) : cat->tracks[t].start;
+
+        info.first = track_at(cat, from);
+        info.from  = from > cat->tracks[info.first].start ? from - cat->tracks[info.first].start : 0;
+        info.last  = cat->lastTrack;
+        info.to    = 0;
+
+        if ((fdwCommand & MCI_TO) && parms)
+        {
+            uint32_t to = frame_of(cat, parms->dwTo);
+
+            /* "to" is exclusive, a range ending where a track starts
+             * does not play any of that track */
+            if (to > from)
+            {
+                info.last = track_at(cat, to - 1);
+                info.to   = to - cat->tracks[info.last].start;
+            }
+
+            if (info.to >= cat->tracks[info.last].frames)
+                info.to = 0;
+
+            /* empty ranges and ones ending before the first track play it
+             * whole, which games ask for with "from N to N" */
+            if (info.last < info.first || to <= from)
+            {
+                info.last = info.first;
+                info.to   = 0;
+            }
+        }
+
+        dprintf("  Playing tracks %d (+%u) to %d (+%u)\r\n", info.first, info.from, info.last, info.to);
+
+        if (fdwCommand & MCI_NOTIFY)
+            notify_replace(notify_target(dwParam), MCI_NOTIFY_SUPERSEDED);
+        else
+            notify_replace(NULL, MCI_NOTIFY_ABORTED);
+
+        state_set(STATE_PLAYING);
+
+        /* with only a few milliseconds queued the decoder must not wait behind the game */
+        player = os_thread_start(player_main, &info, 1);
+
+        return 0;
+    }
+	else
+    if (uMsg == MCI_STOP)
+    {
+        player_join(STATE_STOPPED);
+        notify_replace(NULL, MCI_NOTIFY_ABORTED);
+        return 0;
+    }
+	else
+    if (uMsg == MCI_PAUSE)
+    {
+        /* freeze the device right away, queued audio stays queued */
+        if (state_move(STATE_PLAYING, STATE_PAUSED))
+            plr_pause();
+        return 0;
+    }
+	else
+    if (uMsg == MCI_RESUME)
+    {
+        uint64_t t0 = stat_ticks();
+
+        if (state_move(STATE_PAUSED, STATE_PLAYING))
+        {
+            plr_resume();
+            dprintf("  Resumed in %u us\r\n", stat_us(stat_ticks() - t0));
+        }
+        return 0;
+    }
+	else
+    if (uMsg == MCI_SYSINFO)
+    {
+        MCI_SYSINFO_PARMS *parms = (MCI_SYSINFO_PARMS *)dwParam;
+
+        /* one cdaudio device, as "sysinfo cdaudio quantity" answers */
+        if (parms && (fdwCommand & MCI_SYSINFO_QUANTITY) && parms->lpstrReturn && parms->dwRetSize >= sizeof(DWORD))
+        {
+            dprintf("  Returning quantity: 1\r\n");
+            *(DWORD *)parms->lpstrReturn = 1;
+            return 0;
+        }
+    }
+	else
+	if (uMsg == MCI_INFO)
+	{
+		
+	}
+	else
+    if (uMsg == MCI_STATUS)
+    {
+        MCI_STATUS_PARMS *parms = (MCI_STATUS_PARMS *)dwParam;
+
+        if (parms && parms->dwItem == MCI_STATUS_MODE)
+        {
+            LONG s = state;
+
+            parms->dwReturn = s == STATE_PLAYING ? MCI_MODE_PLAY :
+                              s == STATE_PAUSED  ? MCI_MODE_PAUSE :
+                              s == STATE_STOPPED ? MCI_MODE_STOP : MCI_MODE_NOT_READY;
+            return 0;
+        }
+
+        int track = (fdwCommand & MCI_TRACK) && parms ? (int)parms->dwTrack : 0;
+
+        if (parms && (fdwCommand & MCI_TRACK) && (track < 1 || track > cat->lastTrack))
+            return MCIERR_OUTOFRANGE;
+
+        /* an empty disc has no track to be in */
+        if (parms && cat->firstTrack < 1 && (parms->dwItem == MCI_STATUS_POSITION || parms->dwItem == MCI_STATUS_CURRENT_TRACK))
+        {
+            parms->dwReturn = 0;
+            return 0;
+        }
+
+        if (parms && parms->dwItem == MCI_STATUS_LENGTH)
+        {
+            const struct track_info *last = &cat->tracks[cat->lastTrack];
+            uint32_t disc = cat->lastTrack ? last->start + last->frames - CD_LEADIN : 0;
+
+            parms->dwReturn = length_of(track ? cat->tracks[track].frames : disc);
+            return 0;
+        }
+
+        if (parms && parms->dwItem == MCI_STATUS_POSITION)
+        {
+            if (track && time_format == MCI_FORMAT_TMSF)
+                parms->dwReturn = cd_tmsf(track, 0);
+            else
+                parms->dwReturn = position_of(cat, track ? cat->tracks[track].start : current_frame(cat));
+            return 0;
+        }
+
+        if (parms && parms->dwItem == MCI_STATUS_NUMBER_OF_TRACKS)
+        {
+            parms->dwReturn = cat->numTracks;
+            return 0;
+        }
+
+        if (parms && parms->dwItem == MCI_STATUS_CURRENT_TRACK)
+        {
+            parms->dwReturn = track_at(cat, current_frame(cat));
+            return 0;
+        }
+
+        if (parms && parms->dwItem == MCI_CDA_STATUS_TYPE_TRACK && track)
+        {
+            parms->dwReturn = cat->tracks[track].path[0] ? MCI_CDA_TRACK_AUDIO : MCI_CDA_TRACK_OTHER;
+            return 0;
+        }
+    }
+
+    /* fallback */
+    return MCIERR_UNRECOGNIZED_COMMAND;
+}
+
+/* play notifies when it finishes, everything else as soon as it is done */
+MCIERROR core_command(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam)
+{
+    MCIERROR err;
+
+    os_mutex_lock(command_lock);
+    err = mci_command(catalog_get(), IDDevice, uMsg, fdwCommand, dwParam);
+    catalog_put();
+    os_mutex_unlock(command_lock);
+
+    if (err)
+        lprintf(LOG_WARN, "  MCI command %04X failed with %u\r\n", uMsg, (unsigned)err);
+
+    if (err == 0 && (fdwCommand & MCI_NOTIFY) && uMsg != MCI_PLAY)
+        host.notify(notify_target(dwParam), MCI_NOTIFY_SUCCESSFUL);
+
+    return err;
+}
+
+/* Times in command strings are "t:m:s:f" in TMSF, "m:s:f" in MSF and plain
+ * numbers in milliseconds. Fields may be left out from the right, a lone
+ * number is a track or minutes. */
+static DWORD parse_time(const char *s)
+{
+    int v[4] = { 0, 0, 0, 0 };
+
+    sscanf(s, "%d:%d:%d:%d", &v[0], &v[1], &v[2], &v[3]);
+
+    if (time_format == MCI_FORMAT_TMSF)
+        return MCI_MAKE_TMSF(v[0], v[1], v[2], v[3]);
+
+    if (time_format == MCI_FORMAT_MSF)
+        return MCI_MAKE_MSF(v[0], v[1], v[2]);
+
+    return (DWORD)v[0];
+}
+
+/* the reverse of parse_time(), with every field */
+static void print_time(LPSTR ret, DWORD t, int format)
+{
+    if (format == MCI_FORMAT_TMSF)
+        sprintf(ret, "%02d:%02d:%02d:%02d", MCI_TMSF_TRACK(t), MCI_TMSF_MINUTE(t), MCI_TMSF_SECOND(t), MCI_TMSF_FRAME(t));
+    else if (format == MCI_FORMAT_MSF)
+        sprintf(ret, "%02d:%02d:%02d", MCI_MSF_MINUTE(t), MCI_MSF_SECOND(t), MCI_MSF_FRAME(t));
+    else
+        sprintf(ret, "%u", (unsigned)t);
+}
+
+/* MCI command strings */
+/* https://docs.microsoft.com/windows/win32/multimedia/multimedia-command-strings */
+MCIERROR core_string(LPCSTR cmd, LPSTR ret, UINT cchReturn, HWND hwndCallback)
+{
+	MCIERROR err = 0; /* strings nobody handles are accepted and ignored */
+	if(TRUE) {
+		char sCommand[80+1];
+		char *sCmdTarget;
+		DWORD dwCommand;
+		
+		DWORD dwNewTimeFormat = -1;
+		
+		char cmdbuf[1024];
+		char cmp_str[1024];
+
+		sCommand[0] = '\0';
+		sscanf(cmd, "%80s", sCommand);
+
+		if(!strcmp(sCommand, "open")) dwCommand = MCI_OPEN; else
+		if(!strcmp(sCommand, "close")) dwCommand = MCI_CLOSE; else
+		if(!strcmp(sCommand, "stop")) dwCommand = MCI_STOP; else
+		if(!strcmp(sCommand, "pause")) dwCommand = MCI_PAUSE; else
+		if(!strcmp(sCommand, "resume")) dwCommand = MCI_RESUME; else
+		if(!strcmp(sCommand, "set")) dwCommand = MCI_SET; else
+		if(!strcmp(sCommand, "status")) dwCommand = MCI_STATUS; else
+		if(!strcmp(sCommand, "play")) dwCommand = MCI_PLAY; else
+		if(!strcmp(sCommand, "seek")) dwCommand = MCI_SEEK; else
+		if(!strcmp(sCommand, "capability")) dwCommand = MCI_GETDEVCAPS; else
+		dwCommand = 0; 
+		
+		if(dwCommand && (dwCommand != MCI_OPEN)){
+			// don't try to parse unknown commands, nor open command that
+			// doesn't necessarily have extra arguments
+			sCmdTarget = (char *)cmd;
+			while (*sCmdTarget && *sCmdTarget != ' ') sCmdTarget++; // skip command
+			while (*sCmdTarget && *sCmdTarget == ' ') sCmdTarget++; // skip first separator
+			while (*sCmdTarget && *sCmdTarget != ' ') sCmdTarget++; // skip deviceid
+			while (*sCmdTarget && *sCmdTarget == ' ') sCmdTarget++; // skip second separator
+		}
+
+		dprintf("[MCI String = %s]\n", cmd);
+
+		/* copy cmd into cmdbuf */
+		strcpy (cmdbuf,cmd);
+		/* change cmdbuf into lower case */
+		for (int i = 0; cmdbuf[i]; i++)
+		{
+			cmdbuf[i] = tolower(cmdbuf[i]);
+		}
+
+		if (strstr(cmd, "sysinfo cdaudio quantity"))
+		{
+			dprintf("  Returning quantity: 1\r\n");
+			strcpy(ret, "1");
+			return 0;
+		}
+
+		/* Example: "sysinfo cdaudio name 1 open" returns "cdaudio" or the alias.*/
+		if (strstr(cmd, "sysinfo cdaudio name"))
+		{
+			dprintf("  Returning name: cdaudio\r\n");
+			sprintf(ret, "%s", alias_s);
+			return 0;
+		}	
+
+		sprintf(cmp_str, "info %s", alias_s);
+		if (strstr(cmd, cmp_str))
+		{
+			host.send(MAGIC_DEVICEID, MCI_INFO, 0, (DWORD_PTR)NULL);
+			return 0;
+		}
+		
+		sprintf(cmp_str, "stop %s", alias_s);
+		if (strstr(cmd, cmp_str))
+		{
+			host.send(MAGIC_DEVICEID, MCI_STOP, 0, (DWORD_PTR)NULL);
+			return 0;
+		}
+
+		sprintf(cmp_str, "pause %s", alias_s);
+		if (strstr(cmd, cmp_str))
+		{
+			host.send(MAGIC_DEVICEID, MCI_PAUSE, 0, (DWORD_PTR)NULL);
+			return 0;
+		}
+
+		sprintf(cmp_str, "resume %s", alias_s);
+		if (strstr(cmd, cmp_str))
+		{
+			host.send(MAGIC_DEVICEID, MCI_RESUME, 0, (DWORD_PTR)NULL);
+			return 0;
+		}
+
+		sprintf(cmp_str, "open %s", alias_s);
+		if (strstr(cmd, cmp_str))
+		{
+			host.send(MAGIC_DEVICEID, MCI_OPEN, 0, (DWORD_PTR)NULL);
+			return 0;
+		}
+		
+		sprintf(cmp_str, "close %s", alias_s);
+		if (strstr(cmd, cmp_str))
+		{
+			host.send(MAGIC_DEVICEID, MCI_CLOSE, 0, (DWORD_PTR)NULL);
+			return 0;
+		}
+
+		/* Handle "set cdaudio/alias time format" */
+		sprintf(cmp_str, "set %s", alias_s);
+		if (strstr(cmd, cmp_str))
+		{
+			dwNewTimeFormat = -1;
+			if (strstr(cmd, "time format milliseconds"))
+			{
+				static MCI_SET_PARMS parms;
+				parms.dwTimeFormat = MCI_FORMAT_MILLISECONDS;
+				host.send(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
+				dwNewTimeFormat = 1;
+				return 0;
+			}
+			else
+			if (strstr(cmd, "time format tmsf"))
+			{
+				static MCI_SET_PARMS parms;
+				parms.dwTimeFormat = MCI_FORMAT_TMSF;
+				host.send(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
+				dwNewTimeFormat = 2;
+				return 0;
+			}
+			else
+			if (strstr(cmd, "time format msf"))
+			{
+				static MCI_SET_PARMS parms;
+				parms.dwTimeFormat = MCI_FORMAT_MSF;
+				host.send(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
+				dwNewTimeFormat = 3;
+				return 0;
+			}
+			else
+			if (dwNewTimeFormat == -1)
+			{
+				lprintf(LOG_WARN, "set time format failed\r\n");
+				host.send(MAGIC_DEVICEID, MCI_CLOSE, 0, (DWORD_PTR)NULL);
+			}
+		}
+
+		/* Handle "status cdaudio/alias" */
+		sprintf(cmp_str, "status %s", alias_s);
+		if (strstr(cmd, cmp_str)){
+			if (strstr(cmd, "number of tracks"))
+			{
+				static MCI_STATUS_PARMS parms;
+				parms.dwItem = MCI_STATUS_NUMBER_OF_TRACKS;
+				host.send(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_WAIT, (DWORD_PTR)&parms);
+				dprintf("  Returning number of tracks (%d)\r\n", (int)parms.dwReturn);
+				sprintf(ret, "%d", (int)parms.dwReturn);
+				return 0;
+			}
+			int track = 0;
+			if (sscanf(cmd, "status %*s length track %d", &track) == 1)
+			{
+				static MCI_STATUS_PARMS parms;
+				parms.dwItem = MCI_STATUS_LENGTH;
+				parms.dwTrack = track;
+				err = host.send(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_TRACK|MCI_WAIT, (DWORD_PTR)&parms);
+				if (!err) print_time(ret, parms.dwReturn, time_format == MCI_FORMAT_MILLISECONDS ? time_format : MCI_FORMAT_MSF);
+				return err;
+			}
+			if (strstr(cmd, "length"))
+			{
+				static MCI_STATUS_PARMS parms;
+				parms.dwItem = MCI_STATUS_LENGTH;
+				host.send(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM, (DWORD_PTR)&parms);
+				print_time(ret, parms.dwReturn, time_format == MCI_FORMAT_MILLISECONDS ? time_format : MCI_FORMAT_MSF);
+				return 0;
+			}
+			if (sscanf(cmd, "status %*s type track %d", &track) == 1)
+			{
+				static MCI_STATUS_PARMS parms;
+				parms.dwItem = MCI_CDA_STATUS_TYPE_TRACK;
+				parms.dwTrack = track;
+				err = host.send(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_TRACK, (DWORD_PTR)&parms);
+				if (!err) strcpy(ret, parms.dwReturn == MCI_CDA_TRACK_AUDIO ? "audio" : "other");
+				return err;
+			}
+			if (sscanf(cmd, "status %*s position track %d", &track) == 1)
+			{
+				static MCI_STATUS_PARMS parms;
+				parms.dwItem = MCI_STATUS_POSITION;
+				parms.dwTrack = track;
+				err = host.send(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_TRACK, (DWORD_PTR)&parms);
+				if (!err) print_time(ret, parms.dwReturn, time_format);
+				return err;
+			}
+			if (strstr(cmd, "position"))
+			{
+				static MCI_STATUS_PARMS parms;
+				parms.dwItem = MCI_STATUS_POSITION;
+				host.send(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM, (DWORD_PTR)&parms);
+				print_time(ret, parms.dwReturn, time_format);
+				return 0;
+			}
+			if (strstr(cmd, "mode"))
+			{
+				static MCI_STATUS_PARMS parms;
+				parms.dwItem = MCI_STATUS_MODE;
+				host.send(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_STATUS_MODE, (DWORD_PTR)&parms);
+				sprintf(ret, "%d", (int)parms.dwReturn);
+				return 0;
+			}
+			if (strstr(cmd, "current"))
+			{
+				static MCI_STATUS_PARMS parms;
+				parms.dwItem = MCI_STATUS_CURRENT_TRACK;
+				host.send(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM, (DWORD_PTR)&parms);
+				sprintf(ret, "%d", (int)parms.dwReturn);
+				return 0;
+			}
+			if (strstr(cmd, "media present"))
+			{
+				strcpy(ret, "TRUE");
+				return 0;
+			}
+		}
+
+		/* Handle "play cdaudio/alias" */
+		char from[32], to[32];
+		sprintf(cmp_str, "play %s", alias_s);
+		if (strstr(cmd, cmp_str))
+		{
+			DWORD flags = strstr(cmd, "notify") ? MCI_NOTIFY : 0; /* storing the notify request */
+
+			if (sscanf(cmd, "play %*s from %31s to %31s", from, to) == 2)
+			{
+				static MCI_PLAY_PARMS parms;
+				parms.dwCallback = (DWORD_PTR)hwndCallback;
+				parms.dwFrom = parse_time(from);
+				parms.dwTo = parse_time(to);
+				host.send(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM|MCI_TO|flags, (DWORD_PTR)&parms);
+				return 0;
+			}
+			if (sscanf(cmd, "play %*s from %31s", from) == 1)
+			{
+				static MCI_PLAY_PARMS parms;
+				parms.dwCallback = (DWORD_PTR)hwndCallback;
+				parms.dwFrom = parse_time(from);
+				host.send(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM|flags, (DWORD_PTR)&parms);
+				return 0;
+			}
+			if (sscanf(cmd, "play %*s to %31s", to) == 1)
+			{
+				static MCI_PLAY_PARMS parms;
+				parms.dwCallback = (DWORD_PTR)hwndCallback;
+				parms.dwTo = parse_time(to);
+				host.send(MAGIC_DEVICEID, MCI_PLAY, MCI_TO|flags, (DWORD_PTR)&parms);
+				return 0;
+			}
+
+			static MCI_PLAY_PARMS parms;
+			parms.dwCallback = (DWORD_PTR)hwndCallback;
+			host.send(MAGIC_DEVICEID, MCI_PLAY, flags, (DWORD_PTR)&parms);
+			return 0;
+		}
+	}
+    return err;
+}
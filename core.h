@@ -0,0 +1,25 @@
+/* The emulated cdaudio device without Win32, see core.c */
+
+#include "mcidefs.h"
+
+#define MAGIC_DEVICEID 0xBEEF
+
+/* what the core needs from whoever hosts it */
+struct core_host
+{
+    /* string commands are sent through this, the DLL passes its exported
+     * mciSendCommandA so they are counted and traced like the game's own */
+    MCIERROR (WINAPI *send)(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam);
+
+    /* delivers MM_MCINOTIFY */
+    void (*notify)(HWND hwnd, WPARAM status);
+};
+
+void core_init(const struct core_host *host);
+int core_scan(const char *music_path, int mode);
+int core_watch();
+void core_unwatch(int wait);
+void core_loop(int track, int64_t start, int64_t length);
+void core_loop_tags(int on);
+MCIERROR core_command(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam);
+MCIERROR core_string(LPCSTR cmd, LPSTR ret, UINT cchReturn, HWND hwndCallback);
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "cdtime.h"
+#include "os.h"
+#include "cue.h"
+
+/* Reads the parts of a CUE sheet that lay out a disc: FILE, TRACK and
+ * INDEX 01. Pregaps, INDEX 00 and the metadata commands are skipped, the
+ * pregap audio stays with the track before like on a one file rip. */
+
+/* next word or "quoted string" of *s into buf */
+static int cue_word(const char **s, char *buf, int size)
+{
+    const char *p = *s;
+    char end = ' ';
+    int n = 0;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+
+    if (*p == '"')
+    {
+        end = '"';
+        p++;
+    }
+
+    while (*p && *p != end && *p != '\r' && *p != '\n' && (end == '"' || *p != '\t'))
+    {
+        if (n < size - 1)
+            buf[n++] = *p;
+        p++;
+    }
+
+    if (*p == '"')
+        p++;
+
+    buf[n] = '\0';
+    *s = p;
+    return n > 0;
+}
+
+/* Fills tracks from the sheet at path, FILE names are taken relative to its
+ * folder. Returns the number of tracks, 0 if there are none or the sheet
+ * can't be read. */
+int cue_read(const char *path, struct cue_track *tracks, int max)
+{
+    FILE *fp = fopen(path, "r");
+    char line[512], word[MAX_PATH], file[MAX_PATH] = "", dir[MAX_PATH];
+    struct cue_track *t = NULL;
+    int count = 0;
+    char *slash;
+
+    if (!fp)
+        return 0;
+
+    snprintf(dir, sizeof dir, "%s", path);
+    slash = strrchr(dir, OS_PATH_SEP[0]);
+    if (slash)
+        *slash = '\0';
+    else
+        strcpy(dir, ".");
+
+    while (fgets(line, sizeof line, fp))
+    {
+        const char *s = line;
+
+        /* UTF-8 byte order mark */
+        if (!memcmp(s, "\xEF\xBB\xBF", 3))
+            s += 3;
+
+        if (!cue_word(&s, word, sizeof word))
+            continue;
+
+        if (!strcasecmp(word, "FILE") && cue_word(&s, word, sizeof word))
+        {
+            int n = snprintf(file, sizeof file, "%s" OS_PATH_SEP "%s", dir, word);
+
+            /* a cut off name could open another file, the tracks in it
+             * become data tracks instead */
+            if (n < 0 || n >= sizeof file)
+                file[0] = '\0';
+        }
+        else if (!strcasecmp(word, "TRACK") && cue_word(&s, word, sizeof word))
+        {
+            int n = atoi(word);
+
+            /* track numbers index the catalog */
+            t = NULL;
+            if (n < 1 || n > CUE_MAX_TRACKS || count == max)
+                continue;
+
+            t = &tracks[count++];
+            t->number = n;
+            t->audio = cue_word(&s, word, sizeof word) && !strcasecmp(word, "AUDIO");
+            t->index = 0;
+            snprintf(t->file, sizeof t->file, "%s", file);
+        }
+        else if (!strcasecmp(word, "INDEX") && t && cue_word(&s, word, sizeof word) && atoi(word) == 1)
+        {
+            int m = 0, sec = 0, f = 0;
+
+            if (cue_word(&s, word, sizeof word))
+                sscanf(word, "%d:%d:%d", &m, &sec, &f);
+
+            t->index = (m * 60 + sec) * CD_FPS + f;
+        }
+    }
+
+    fclose(fp);
+    return count;
+}
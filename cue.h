@@ -0,0 +1,16 @@
+/* CUE sheets of single file disc images, see cue.c */
+
+#include <stdint.h>
+#include "mcidefs.h"
+
+#define CUE_MAX_TRACKS 99
+
+struct cue_track
+{
+    int number;
+    int audio;              /* TRACK nn AUDIO, everything else is data */
+    char file[MAX_PATH];    /* full path of the FILE the track is in */
+    uint32_t index;         /* INDEX 01, CD frames from the start of the file */
+};
+
+int cue_read(const char *path, struct cue_track *tracks, int max);
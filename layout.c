@@ -0,0 +1,175 @@
+#include <string.h>
+#include "layout.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define LAYOUT_SSE2
+#endif
+
+/* Vorbis orders the channels of each count as below. Everything is folded
+ * to stereo the usual way, centre and surrounds at -3 dB and no LFE, and
+ * each output row is scaled down to a sum of 1 so a downmix can't clip.
+ * Mono goes out as stereo at full level. */
+
+#define C1  16384           /* 1.0 */
+#define C3  11585           /* -3 dB */
+
+/* left and right weight of every input channel, by channel count */
+static const int16_t fold[LAYOUT_MAX_CHANNELS][LAYOUT_MAX_CHANNELS][2] =
+{
+    { { C1, C1 } },                                                                 /* M */
+    { { C1, 0 }, { 0, C1 } },                                                       /* L R */
+    { { C1, 0 }, { C3, C3 }, { 0, C1 } },                                           /* L C R */
+    { { C1, 0 }, { 0, C1 }, { C3, 0 }, { 0, C3 } },                                 /* FL FR RL RR */
+    { { C1, 0 }, { C3, C3 }, { 0, C1 }, { C3, 0 }, { 0, C3 } },                     /* FL C FR RL RR */
+    { { C1, 0 }, { C3, C3 }, { 0, C1 }, { C3, 0 }, { 0, C3 }, { 0, 0 } },           /* + LFE */
+    { { C1, 0 }, { C3, C3 }, { 0, C1 }, { C3, 0 }, { 0, C3 }, { C3, C3 }, { 0, 0 } },  /* FL C FR SL SR RC LFE */
+    { { C1, 0 }, { C3, C3 }, { 0, C1 }, { C3, 0 }, { 0, C3 }, { C3, 0 }, { 0, C3 }, { 0, 0 } },  /* FL C FR SL SR RL RR LFE */
+};
+
+/* the matrix from in channels, 1 to LAYOUT_MAX_CHANNELS, to out, which is
+ * 1 or 2 unless it is in */
+void layout_matrix(struct layout *l, int in, int out)
+{
+    int32_t left = 0, right = 0;
+    int i;
+
+    memset(l, 0, sizeof *l);
+    l->in = in;
+    l->out = out;
+
+    if (in == out)
+    {
+        for (i = 0; i < in; i++)
+            l->m[i][i] = C1;
+        return;
+    }
+
+    for (i = 0; i < in; i++)
+    {
+        left += fold[in - 1][i][0];
+        right += fold[in - 1][i][1];
+    }
+
+    /* mono stays at full level on both sides */
+    if (in == 1)
+        left = right = C1;
+
+    for (i = 0; i < in; i++)
+    {
+        int16_t a = (int32_t)fold[in - 1][i][0] * C1 / left;
+        int16_t b = (int32_t)fold[in - 1][i][1] * C1 / right;
+
+        if (out == 1)
+        {
+            l->m[0][i] = (a + b) / 2;
+            continue;
+        }
+
+        l->m[0][i] = a;
+        l->m[1][i] = b;
+    }
+}
+
+void layout_convert_scalar(const struct layout *l, const int16_t *src, int16_t *dst, int frames)
+{
+    int f, o, i;
+
+    for (f = 0; f < frames; f++, src += l->in)
+    {
+        for (o = 0; o < l->out; o++)
+        {
+            int32_t s = 1 << 13;
+
+            for (i = 0; i < l->in; i++)
+                s += l->m[o][i] * src[i];
+
+            s >>= 14;
+            *dst++ = s > 32767 ? 32767 : s < -32768 ? -32768 : s;
+        }
+    }
+}
+
+#ifdef LAYOUT_SSE2
+/* One frame per iteration: pmaddwd multiplies the whole frame by two rows
+ * at once, up to 8 channels in one register, and the partial sums of both
+ * rows are folded together. The unused lanes of the rows are zero, so the
+ * samples of the next frame loaded with it don't count; the last frames,
+ * where that load would run past the end, are left to the scalar code. */
+__attribute__((target("sse2")))
+static void layout_convert_sse2(const struct layout *l, const int16_t *src, int16_t *dst, int frames)
+{
+    __m128i rows[LAYOUT_MAX_CHANNELS / 2][2];
+    __m128i round = _mm_set1_epi32(1 << 13);
+    int pairs = (l->out + 1) / 2, in = l->in, safe = frames - 7 / in, f, p;
+
+    for (p = 0; p < pairs; p++)
+    {
+        rows[p][0] = _mm_loadu_si128((const __m128i *)l->m[2 * p]);
+        rows[p][1] = _mm_loadu_si128((const __m128i *)l->m[2 * p + 1]);
+    }
+
+    for (f = 0; f < safe; f++, src += in)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)src);
+
+        for (p = 0; p < pairs; p++)
+        {
+            __m128i a = _mm_madd_epi16(x, rows[p][0]);
+            __m128i b = _mm_madd_epi16(x, rows[p][1]);
+            __m128i s = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+
+            s = _mm_add_epi32(s, _mm_unpackhi_epi64(s, s));
+            s = _mm_srai_epi32(_mm_add_epi32(s, round), 14);
+            s = _mm_packs_epi32(s, s);
+
+            /* both outputs of the pair, or the odd last one alone */
+            int32_t v = _mm_cvtsi128_si32(s);
+            memcpy(dst + 2 * p, &v, 2 * p + 1 < l->out ? 4 : 2);
+        }
+
+        dst += l->out;
+    }
+
+    layout_convert_scalar(l, src, dst, frames - f);
+}
+
+/* mono to stereo at full level is every sample twice */
+__attribute__((target("sse2")))
+static void layout_dup_sse2(const int16_t *src, int16_t *dst, int frames)
+{
+    int f;
+
+    for (f = 0; f + 8 <= frames; f += 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + f));
+
+        _mm_storeu_si128((__m128i *)(dst + 2 * f), _mm_unpacklo_epi16(s, s));
+        _mm_storeu_si128((__m128i *)(dst + 2 * f + 8), _mm_unpackhi_epi16(s, s));
+    }
+
+    for (; f < frames; f++)
+        dst[2 * f] = dst[2 * f + 1] = src[f];
+}
+
+static void layout_convert_sse2_dispatch(const struct layout *l, const int16_t *src, int16_t *dst, int frames)
+{
+    if (l->in == 1 && l->out == 2 && l->m[0][0] == C1 && l->m[1][0] == C1)
+        layout_dup_sse2(src, dst, frames);
+    else
+        layout_convert_sse2(l, src, dst, frames);
+}
+#endif
+
+void (*layout_convert)(const struct layout *l, const int16_t *src, int16_t *dst, int frames) = layout_convert_scalar;
+
+/* picks the SSE2 kernel when the CPU has it, like mix_kernel_init() */
+void layout_kernel_init()
+{
+#ifdef LAYOUT_SSE2
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2"))
+        layout_convert = layout_convert_sse2_dispatch;
+#endif
+}
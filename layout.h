@@ -0,0 +1,21 @@
+/* Channel layout conversion for the player, see layout.c. Plain C without
+ * Win32 like mixkernel.c, tools/mixbench measures it too. */
+
+#include <stdint.h>
+
+#define LAYOUT_MAX_CHANNELS 8
+
+/* out[o] = sum of m[o][i] * in[i], coefficients in 2.14 fixed point, rows
+ * zero past the input's channels */
+struct layout
+{
+    int in;
+    int out;
+    int16_t m[LAYOUT_MAX_CHANNELS][LAYOUT_MAX_CHANNELS];
+};
+
+void layout_matrix(struct layout *l, int in, int out);
+void layout_convert_scalar(const struct layout *l, const int16_t *src, int16_t *dst, int frames);
+
+void layout_kernel_init();
+extern void (*layout_convert)(const struct layout *l, const int16_t *src, int16_t *dst, int frames);
@@ -0,0 +1,144 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include "log.h"
+
+/* Producers claim a slot of a bounded ring with a compare-exchange, format
+ * straight into it and publish it by bumping the slot sequence. They never
+ * wait: when the ring is full the message is counted as dropped. A writer
+ * thread drains the ring every LOG_FLUSH_MS and writes the batch with a
+ * single fflush. */
+
+#define LOG_SLOTS       256     /* power of two */
+#define LOG_SLOT_SIZE   256
+#define LOG_FLUSH_MS    50
+
+struct log_slot
+{
+    volatile LONG seq;
+    char text[LOG_SLOT_SIZE];
+};
+
+static struct log_slot  log_ring[LOG_SLOTS];
+static volatile LONG    log_head        = 0;
+static LONG             log_tail        = 0;
+static volatile LONG    log_dropped     = 0;
+static LONG             log_reported    = 0;
+static int              log_level       = -1;
+static FILE             *log_fp         = NULL;
+static HANDLE           log_ev          = NULL;
+static CRITICAL_SECTION log_cs;         /* consumers only */
+
+void log_write(int level, const char *fmt, ...)
+{
+    struct log_slot *slot;
+    va_list args;
+    LONG pos;
+
+    if (level > log_level)
+        return;
+
+    while (1)
+    {
+        pos = log_head;
+        slot = &log_ring[pos & (LOG_SLOTS - 1)];
+
+        LONG diff = slot->seq - pos;
+
+        if (diff < 0)
+        {
+            /* ring is full, the writer thread is behind */
+            InterlockedIncrement(&log_dropped);
+            return;
+        }
+
+        if (diff == 0 && InterlockedCompareExchange(&log_head, pos + 1, pos) == pos)
+            break;
+    }
+
+    va_start(args, fmt);
+    vsnprintf(slot->text, sizeof slot->text, fmt, args);
+    va_end(args);
+
+    InterlockedExchange(&slot->seq, pos + 1);
+}
+
+/* writes everything published so far, returns the number of messages */
+static int log_drain()
+{
+    int count = 0;
+
+    EnterCriticalSection(&log_cs);
+
+    while (log_fp)
+    {
+        struct log_slot *slot = &log_ring[log_tail & (LOG_SLOTS - 1)];
+
+        if (slot->seq != log_tail + 1)
+            break;
+
+        fputs(slot->text, log_fp);
+        InterlockedExchange(&slot->seq, log_tail + LOG_SLOTS);
+        log_tail++;
+        count++;
+    }
+
+    LONG dropped = log_dropped;
+    if (log_fp && dropped != log_reported)
+    {
+        fprintf(log_fp, "[log: %ld messages dropped]\r\n", (long)(dropped - log_reported));
+        log_reported = dropped;
+        count++;
+    }
+
+    if (log_fp && count)
+        fflush(log_fp);
+
+    LeaveCriticalSection(&log_cs);
+
+    return count;
+}
+
+static DWORD WINAPI log_main(LPVOID unused)
+{
+    while (WaitForSingleObject(log_ev, LOG_FLUSH_MS) != WAIT_OBJECT_0)
+        log_drain();
+
+    return 0;
+}
+
+void log_open(const char *path, int level)
+{
+    int i;
+
+    for (i = 0; i < LOG_SLOTS; i++)
+        log_ring[i].seq = i;
+
+    log_fp = fopen(path, "w");
+
+    if (!log_fp)
+        return;
+
+    InitializeCriticalSection(&log_cs);
+    log_ev = CreateEvent(NULL, TRUE, FALSE, NULL);
+    CreateThread(NULL, 0, log_main, NULL, 0, NULL);
+
+    log_level = level;
+}
+
+/* Called from DllMain, where the writer thread may already be gone, so the
+ * remaining messages are written from here. */
+void log_close()
+{
+    if (!log_fp)
+        return;
+
+    log_level = -1;
+    SetEvent(log_ev);
+    log_drain();
+
+    EnterCriticalSection(&log_cs);
+    fclose(log_fp);
+    log_fp = NULL;
+    LeaveCriticalSection(&log_cs);
+}
@@ -0,0 +1,24 @@
+/* Asynchronous logger, see log.c */
+
+enum log_level
+{
+    LOG_ERROR,
+    LOG_WARN,
+    LOG_INFO,
+    LOG_DEBUG
+};
+
+void log_open(const char *path, int level);
+void log_close();
+void log_write(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* lprintf() at LOG_ERROR or LOG_WARN for what went wrong, dprintf() for
+ * everything else; only debug builds of the dll log, elsewhere the
+ * arguments are still checked against the format */
+#include <stdio.h>
+#if defined(_WIN32) && defined(_DEBUG)
+    #define lprintf(level, ...) log_write(level, __VA_ARGS__)
+#else
+    #define lprintf(level, ...) do { if (0) printf(__VA_ARGS__); } while (0)
+#endif
+#define dprintf(...) lprintf(LOG_DEBUG, __VA_ARGS__)
@@ -0,0 +1,152 @@
+#include <math.h>
+#include <string.h>
+#include "loudness.h"
+
+/* Integrated loudness per EBU R128 / ITU-R BS.1770: the signal goes through
+ * the K-weighting filters, its mean square is taken over 400 ms blocks
+ * every 100 ms, and the blocks above -70 LUFS and above 10 LU under their
+ * own average are averaged again. Blocks are kept in 0.1 LU bins with their
+ * summed energy, so the gates need no second pass over the audio.
+ *
+ * The gain brings a track to LOUD_TARGET, the ReplayGain 2 reference, but
+ * never so far that its peak would clip. The player multiplies by it in
+ * the volume loop, which doesn't saturate. */
+
+#define LOUD_TARGET     -18.0
+#define LOUD_GATE       -70.0
+
+static double loud_lufs(double energy)
+{
+    return -0.691 + 10 * log10(energy);
+}
+
+/* the two K-weighting biquads at rate, from BS.1770's 48 kHz ones */
+void loud_init(struct loudness *l, int rate, int channels)
+{
+    double f0 = 1681.974450955533, q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / rate), vh = pow(10, 3.999843853973347 / 20), vb = pow(vh, 0.4996667741545416);
+    double a0 = 1 + k / q + k * k;
+
+    memset(l, 0, sizeof *l);
+    l->rate = rate;
+    l->channels = rate >= 10 && channels <= LOUD_CHANNELS ? channels : 0;     /* 0 measures nothing */
+    l->sub_frames = rate / 10;
+
+    l->shelf[0] = (vh + vb * k / q + k * k) / a0;
+    l->shelf[1] = 2 * (k * k - vh) / a0;
+    l->shelf[2] = (vh - vb * k / q + k * k) / a0;
+    l->shelf[3] = 2 * (k * k - 1) / a0;
+    l->shelf[4] = (1 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / rate);
+    a0 = 1 + k / q + k * k;
+
+    l->highpass[0] = 1;
+    l->highpass[1] = -2;
+    l->highpass[2] = 1;
+    l->highpass[3] = 2 * (k * k - 1) / a0;
+    l->highpass[4] = (1 - k / q + k * k) / a0;
+}
+
+static void loud_block(struct loudness *l)
+{
+    double energy = (l->subs[0] + l->subs[1] + l->subs[2] + l->subs[3]) / (4.0 * l->sub_frames);
+    int bin;
+
+    if (energy <= 0 || loud_lufs(energy) < LOUD_GATE)
+        return;
+
+    bin = (int)((loud_lufs(energy) - LOUD_GATE) * 10);
+    if (bin >= LOUD_BINS)
+        bin = LOUD_BINS - 1;
+
+    l->count[bin]++;
+    l->energy[bin] += energy;
+}
+
+/* frames of interleaved 16 bit pcm */
+void loud_add(struct loudness *l, const short *pcm, int frames)
+{
+    const double *s = l->shelf, *h = l->highpass;
+    int stride = l->channels, i, c;
+
+    if (l->channels == 0)
+        return;
+
+    for (i = 0; i < frames; i++, pcm += stride)
+    {
+        double sum = 0;
+
+        for (c = 0; c < l->channels; c++)
+        {
+            double *z = l->z[c];
+            double x = pcm[c] / 32768.0, y;
+
+            /* 5.1 in Vorbis order: the surrounds count 1.5 dB more, no LFE */
+            double weight = l->channels == 6 ? (c == 5 ? 0 : c >= 3 ? 1.41 : 1) : 1;
+
+            if (pcm[c] > l->peak || -pcm[c] > l->peak)
+                l->peak = pcm[c] < 0 ? -pcm[c] : pcm[c];
+
+            y = s[0] * x + z[0];
+            z[0] = s[1] * x - s[3] * y + z[1];
+            z[1] = s[2] * x - s[4] * y;
+            x = y;
+
+            y = h[0] * x + z[2];
+            z[2] = h[1] * x - h[3] * y + z[3];
+            z[3] = h[2] * x - h[4] * y;
+
+            sum += weight * y * y;
+        }
+
+        l->sub_sum += sum;
+
+        if (++l->sub_fill < l->sub_frames)
+            continue;
+
+        memmove(l->subs, l->subs + 1, 3 * sizeof *l->subs);
+        l->subs[3] = l->sub_sum;
+        l->sub_sum = 0;
+        l->sub_fill = 0;
+
+        if (++l->num_subs >= 4)
+            loud_block(l);
+    }
+}
+
+/* Gain to the target in hundredths of a dB, rounded down; 0 for silence. */
+int32_t loud_gain(const struct loudness *l)
+{
+    double energy = 0, gated = 0, gain, limit;
+    uint32_t blocks = 0, kept = 0;
+    int i, from;
+
+    for (i = 0; i < LOUD_BINS; i++)
+    {
+        blocks += l->count[i];
+        energy += l->energy[i];
+    }
+
+    if (!blocks)
+        return 0;
+
+    /* the relative gate, a bin is in when its lower edge is */
+    from = (int)ceil((loud_lufs(energy / blocks) - 10 - LOUD_GATE) * 10);
+
+    for (i = from > 0 ? from : 0; i < LOUD_BINS; i++)
+    {
+        kept += l->count[i];
+        gated += l->energy[i];
+    }
+
+    if (!kept)
+        return 0;
+
+    gain = LOUD_TARGET - loud_lufs(gated / kept);
+    limit = l->peak ? -20 * log10(l->peak / 32768.0) : 0;
+
+    return (int32_t)floor((gain < limit ? gain : limit) * 100);
+}
@@ -0,0 +1,27 @@
+/* Loudness of a track as EBU R128 measures it, see loudness.c */
+
+#include <stdint.h>
+
+#define LOUD_CHANNELS   8
+#define LOUD_BINS       750     /* 0.1 LU from -70 to +5 LUFS */
+
+struct loudness
+{
+    int rate;
+    int channels;
+    double shelf[5];                    /* b0 b1 b2 a1 a2 */
+    double highpass[5];
+    double z[LOUD_CHANNELS][4];         /* both filters, transposed form */
+    uint32_t sub_frames;                /* 100 ms */
+    uint32_t sub_fill;
+    double sub_sum;
+    double subs[4];                     /* the last 400 ms block */
+    int num_subs;
+    int peak;                           /* largest sample magnitude */
+    uint32_t count[LOUD_BINS];          /* blocks by loudness */
+    double energy[LOUD_BINS];
+};
+
+void loud_init(struct loudness *l, int rate, int channels);
+void loud_add(struct loudness *l, const short *pcm, int frames);
+int32_t loud_gain(const struct loudness *l);
@@ -0,0 +1,110 @@
+/* The parts of <mmsystem.h> the emulator core uses. Windows builds take the
+ * real header, native builds get the same names and values from here so
+ * core.c compiles unchanged. */
+
+#ifndef MCIDEFS_H
+#define MCIDEFS_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+
+#include <stdint.h>
+
+#define WINAPI
+#define MAX_PATH                    260
+
+typedef int32_t     LONG;
+typedef int         BOOL;
+typedef uint8_t     BYTE;
+typedef uint16_t    WORD;
+typedef uint32_t    DWORD;
+typedef unsigned    UINT;
+typedef uintptr_t   DWORD_PTR;
+typedef uintptr_t   WPARAM;
+typedef void        *HANDLE;
+typedef void        *HWND;
+typedef char        *LPSTR;
+typedef const char  *LPCSTR;
+typedef char        *LPTSTR;
+typedef const char  *LPCTSTR;
+typedef DWORD       MCIERROR;
+typedef UINT        MCIDEVICEID;
+
+#define TRUE                        1
+#define FALSE                       0
+
+#define MCI_OPEN                    0x0803
+#define MCI_CLOSE                   0x0804
+#define MCI_PLAY                    0x0806
+#define MCI_SEEK                    0x0807
+#define MCI_STOP                    0x0808
+#define MCI_PAUSE                   0x0809
+#define MCI_INFO                    0x080A
+#define MCI_GETDEVCAPS              0x080B
+#define MCI_SET                     0x080D
+#define MCI_SYSINFO                 0x0810
+#define MCI_STATUS                  0x0814
+#define MCI_RESUME                  0x0855
+
+#define MCI_NOTIFY                  0x00000001
+#define MCI_WAIT                    0x00000002
+#define MCI_FROM                    0x00000004
+#define MCI_TO                      0x00000008
+#define MCI_TRACK                   0x00000010
+#define MCI_STATUS_ITEM             0x00000100
+#define MCI_SET_TIME_FORMAT         0x00000400
+#define MCI_SYSINFO_QUANTITY        0x00000100
+
+#define MCI_STATUS_LENGTH           0x00000001
+#define MCI_STATUS_POSITION         0x00000002
+#define MCI_STATUS_NUMBER_OF_TRACKS 0x00000003
+#define MCI_STATUS_MODE             0x00000004
+#define MCI_STATUS_MEDIA_PRESENT    0x00000005
+#define MCI_STATUS_TIME_FORMAT      0x00000006
+#define MCI_STATUS_READY            0x00000007
+#define MCI_STATUS_CURRENT_TRACK    0x00000008
+#define MCI_CDA_STATUS_TYPE_TRACK   0x00004001
+#define MCI_CDA_TRACK_AUDIO         1088
+#define MCI_CDA_TRACK_OTHER         1089
+
+#define MCI_FORMAT_MILLISECONDS     0
+#define MCI_FORMAT_MSF              2
+#define MCI_FORMAT_TMSF             10
+
+#define MCI_MODE_NOT_READY          524
+#define MCI_MODE_STOP               525
+#define MCI_MODE_PLAY               526
+#define MCI_MODE_PAUSE              529
+
+#define MCI_NOTIFY_SUCCESSFUL       0x0001
+#define MCI_NOTIFY_SUPERSEDED       0x0002
+#define MCI_NOTIFY_ABORTED          0x0004
+#define MCI_NOTIFY_FAILURE          0x0008
+
+#define MCIERR_BASE                 256
+#define MCIERR_UNRECOGNIZED_COMMAND (MCIERR_BASE + 5)
+#define MCIERR_DEVICE_NOT_READY     (MCIERR_BASE + 20)
+#define MCIERR_OUTOFRANGE           (MCIERR_BASE + 26)
+
+#define MCI_MSF_MINUTE(msf)         ((BYTE)(msf))
+#define MCI_MSF_SECOND(msf)         ((BYTE)(((WORD)(msf)) >> 8))
+#define MCI_MSF_FRAME(msf)          ((BYTE)((msf) >> 16))
+#define MCI_MAKE_MSF(m, s, f)       ((DWORD)(((BYTE)(m) | ((WORD)(s) << 8)) | (((DWORD)(BYTE)(f)) << 16)))
+#define MCI_TMSF_TRACK(tmsf)        ((BYTE)(tmsf))
+#define MCI_TMSF_MINUTE(tmsf)       ((BYTE)(((WORD)(tmsf)) >> 8))
+#define MCI_TMSF_SECOND(tmsf)       ((BYTE)((tmsf) >> 16))
+#define MCI_TMSF_FRAME(tmsf)        ((BYTE)((tmsf) >> 24))
+#define MCI_MAKE_TMSF(t, m, s, f)   ((DWORD)(((BYTE)(t) | ((WORD)(m) << 8)) | (((DWORD)(BYTE)(s) | ((WORD)(f) << 8)) << 16)))
+
+typedef struct { DWORD_PTR dwCallback; } MCI_GENERIC_PARMS;
+typedef struct { DWORD_PTR dwCallback; MCIDEVICEID wDeviceID; LPCSTR lpstrDeviceType; LPCSTR lpstrElementName; LPCSTR lpstrAlias; } MCI_OPEN_PARMS;
+typedef struct { DWORD_PTR dwCallback; DWORD dwFrom; DWORD dwTo; } MCI_PLAY_PARMS;
+typedef struct { DWORD_PTR dwCallback; DWORD dwTo; } MCI_SEEK_PARMS;
+typedef struct { DWORD_PTR dwCallback; DWORD_PTR dwReturn; DWORD dwItem; DWORD dwTrack; } MCI_STATUS_PARMS;
+typedef struct { DWORD_PTR dwCallback; DWORD dwTimeFormat; DWORD dwAudio; } MCI_SET_PARMS;
+typedef struct { DWORD_PTR dwCallback; LPSTR lpstrReturn; DWORD dwRetSize; DWORD dwNumber; UINT wDeviceType; } MCI_SYSINFO_PARMS;
+
+#endif
+
+#endif
@@ -0,0 +1,579 @@
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mixkernel.h"
+#include "mixer.h"
+#include "stubs.h"
+#include "stats.h"
+#include "log.h"
+
+/* Software mixer, enabled with Mixer=1 in wgmus.ini. Instead of opening a
+ * device per waveOutOpen() call, PCM streams become slots in mix_streams and
+ * their handles point at the slot. One thread converts every playing stream
+ * to 16-bit stereo at MIX_RATE, sums them and writes the result to a single
+ * real device with the block size and depth of the latency profile.
+ *
+ * Buffers are returned (WHDR_DONE and WOM_DONE) as soon as they are mixed,
+ * the position counts mixed bytes. Formats the converter does not handle,
+ * WAVE_FORMAT_DIRECT opens and opens past MIX_STREAMS go to the real device
+ * as before. Every waveOut call taking a handle is in mixer.h, so a slot
+ * never reaches the real winmm: GetID and Message answer for the shared
+ * output, pitch and playback rate are not supported and loops
+ * (WHDR_BEGINLOOP) are played once, so BreakLoop has nothing to do. */
+
+#define MIX_RATE        44100
+#define MIX_STREAMS     16
+#define MIX_MAX_BUFFERS 16
+
+struct mix_stream
+{
+    int             used;
+    int             paused;
+    DWORD           block_align;
+    DWORD           callback_type;  /* CALLBACK_* bits of fdwOpen */
+    DWORD           callback;
+    DWORD           instance;
+    WAVEHDR         *head;          /* queued buffers, linked through lpNext */
+    WAVEHDR         *tail;
+    DWORD           offset;         /* bytes of head already mixed */
+    DWORD           position;       /* bytes mixed since open or reset */
+    DWORD           volume;
+    volatile LONG   pending;        /* buffers taken off the queue, WOM_DONE not sent yet */
+    HANDLE          drained;        /* set while pending is 0, both change under mix_cs */
+    struct mix_conv conv;
+};
+
+static struct mix_stream mix_streams[MIX_STREAMS];
+static CRITICAL_SECTION  mix_cs;
+static int               mix_enabled    = 0;
+static int               mix_block_ms   = 20;
+static int               mix_buffers    = 4;
+static int               mix_frames     = 0;
+static HWAVEOUT          mix_hwo        = NULL;
+static HANDLE            mix_ev         = NULL;
+static DWORD             mix_thread_id  = 0;
+static WAVEHDR           mix_hdr[MIX_MAX_BUFFERS];
+static int32_t           *mix_acc;
+static int16_t           *mix_tmp;
+
+void mix_config(int block_ms, int buffers)
+{
+    int i;
+
+    InitializeCriticalSection(&mix_cs);
+    mix_kernel_init();
+
+    for (i = 0; i < MIX_STREAMS; i++)
+        mix_streams[i].drained = CreateEvent(NULL, TRUE, TRUE, NULL);
+
+    mix_block_ms = block_ms < 5 ? 5 : block_ms;
+    mix_buffers  = buffers < 2 ? 2 : buffers > MIX_MAX_BUFFERS ? MIX_MAX_BUFFERS : buffers;
+    mix_enabled  = 1;
+}
+
+static struct mix_stream *mix_stream_of(HWAVEOUT hwo)
+{
+    uintptr_t p = (uintptr_t)hwo, base = (uintptr_t)mix_streams;
+
+    if (p < base || p >= base + sizeof mix_streams || (p - base) % sizeof *mix_streams)
+        return NULL;
+
+    return (struct mix_stream *)hwo;
+}
+
+static int mix_supported(LPCWAVEFORMATEX fmt)
+{
+    return fmt && fmt->wFormatTag == WAVE_FORMAT_PCM
+        && (fmt->nChannels == 1 || fmt->nChannels == 2)
+        && (fmt->wBitsPerSample == 8 || fmt->wBitsPerSample == 16)
+        && fmt->nSamplesPerSec >= 1000 && fmt->nSamplesPerSec <= 192000
+        && fmt->nBlockAlign == fmt->nChannels * fmt->wBitsPerSample / 8;
+}
+
+static void mix_notify(HWAVEOUT hwo, DWORD type, DWORD callback, DWORD instance, UINT msg, WAVEHDR *hdr)
+{
+    switch (type & CALLBACK_TYPEMASK)
+    {
+        case CALLBACK_FUNCTION:
+            ((LPDRVCALLBACK)callback)((HDRVR)hwo, msg, instance, (DWORD_PTR)hdr, 0);
+            break;
+        case CALLBACK_EVENT:
+            SetEvent((HANDLE)callback);
+            break;
+        case CALLBACK_WINDOW:
+            PostMessage((HWND)callback, msg, (WPARAM)hwo, (LPARAM)hdr);
+            break;
+        case CALLBACK_THREAD:
+            PostThreadMessage(callback, msg, (WPARAM)hwo, (LPARAM)hdr);
+            break;
+    }
+}
+
+/* Moves the head buffer of a stream to a done list. WOM_DONE is sent by
+ * mix_finish() after mix_cs is released, the callback may call back into
+ * waveOut. Called with mix_cs held. */
+static void mix_retire(struct mix_stream *s, WAVEHDR ***done)
+{
+    WAVEHDR *h = s->head;
+
+    s->head = h->lpNext;
+    if (!s->head)
+        s->tail = NULL;
+
+    s->offset = 0;
+    if (InterlockedIncrement(&s->pending) == 1)
+        ResetEvent(s->drained);
+
+    h->lpNext = NULL;
+    h->reserved = (DWORD_PTR)s;
+    **done = h;
+    *done = &h->lpNext;
+}
+
+static void mix_finish(WAVEHDR *h)
+{
+    while (h)
+    {
+        WAVEHDR *next = h->lpNext;
+        struct mix_stream *s = (struct mix_stream *)h->reserved;
+
+        h->lpNext = NULL;
+        h->dwFlags = (h->dwFlags & ~WHDR_INQUEUE) | WHDR_DONE;
+        mix_notify((HWAVEOUT)s, s->callback_type, s->callback, s->instance, WOM_DONE, h);
+
+        EnterCriticalSection(&mix_cs);
+        if (InterlockedDecrement(&s->pending) == 0)
+            SetEvent(s->drained);
+        LeaveCriticalSection(&mix_cs);
+
+        h = next;
+    }
+}
+
+/* waits for the mixer thread to finish sending WOM_DONE for a stream, unless
+ * we are that thread and got here from a callback */
+static void mix_drain(struct mix_stream *s)
+{
+    if (GetCurrentThreadId() == mix_thread_id)
+        return;
+
+    WaitForSingleObject(s->drained, INFINITE);
+}
+
+static void mix_block(int16_t *out)
+{
+    WAVEHDR *done = NULL, **done_tail = &done;
+    int i;
+
+    memset(mix_acc, 0, mix_frames * 2 * sizeof *mix_acc);
+
+    EnterCriticalSection(&mix_cs);
+
+    for (i = 0; i < MIX_STREAMS; i++)
+    {
+        struct mix_stream *s = &mix_streams[i];
+        int got = 0, used;
+
+        if (!s->used || s->paused)
+            continue;
+
+        while (got < mix_frames && s->head)
+        {
+            WAVEHDR *h = s->head;
+
+            got += mix_convert(&s->conv, (const uint8_t *)h->lpData + s->offset, (h->dwBufferLength - s->offset) / s->block_align,
+                &used, mix_tmp + got * 2, mix_frames - got);
+
+            s->offset   += used * s->block_align;
+            s->position += used * s->block_align;
+
+            if (h->dwBufferLength - s->offset < s->block_align)
+                mix_retire(s, &done_tail);
+        }
+
+        mix_accumulate(mix_acc, mix_tmp, got * 2);
+    }
+
+    LeaveCriticalSection(&mix_cs);
+
+    mix_pack(out, mix_acc, mix_frames * 2);
+    mix_finish(done);
+}
+
+/* Keeps every output buffer on the device. Idle streams mix to silence, the
+ * device never starves and the latency stays the same whatever plays. */
+static DWORD WINAPI mix_main(LPVOID unused)
+{
+    int i;
+
+    while (1)
+    {
+        for (i = 0; i < mix_buffers; i++)
+        {
+            if (!(mix_hdr[i].dwFlags & WHDR_INQUEUE))
+            {
+                uint64_t t0 = stat_ticks();
+                mix_block((int16_t *)mix_hdr[i].lpData);
+                stat_record(HIST_MIX_US, stat_us(stat_ticks() - t0));
+
+                real_waveOutWrite(mix_hwo, &mix_hdr[i], sizeof(WAVEHDR));
+            }
+        }
+
+        WaitForSingleObject(mix_ev, INFINITE);
+    }
+
+    return 0;
+}
+
+/* opens the shared output on the first mixed stream, called with mix_cs held */
+static int mix_output_open()
+{
+    WAVEFORMATEX fmt;
+    HANDLE thread;
+    int i;
+
+    if (mix_hwo)
+        return 1;
+
+    fmt.wFormatTag      = WAVE_FORMAT_PCM;
+    fmt.nChannels       = 2;
+    fmt.nSamplesPerSec  = MIX_RATE;
+    fmt.wBitsPerSample  = 16;
+    fmt.nBlockAlign     = 4;
+    fmt.nAvgBytesPerSec = MIX_RATE * 4;
+    fmt.cbSize          = 0;
+
+    mix_ev = CreateEvent(NULL, 0, 0, NULL);
+
+    if (real_waveOutOpen(&mix_hwo, WAVE_MAPPER, &fmt, (DWORD)(DWORD_PTR)mix_ev, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+    {
+        log_write(LOG_ERROR, "mixer: opening the output failed, mixing disabled\r\n");
+        CloseHandle(mix_ev);
+        mix_hwo = NULL;
+        mix_enabled = 0;
+        return 0;
+    }
+
+    mix_frames = MIX_RATE * mix_block_ms / 1000;
+    mix_acc = malloc(mix_frames * 2 * sizeof *mix_acc);
+    mix_tmp = malloc(mix_frames * 2 * sizeof *mix_tmp);
+
+    for (i = 0; i < mix_buffers; i++)
+    {
+        memset(&mix_hdr[i], 0, sizeof mix_hdr[i]);
+        mix_hdr[i].dwBufferLength = mix_frames * 4;
+        mix_hdr[i].lpData = calloc(mix_frames, 4);
+        real_waveOutPrepareHeader(mix_hwo, &mix_hdr[i], sizeof(WAVEHDR));
+    }
+
+    thread = CreateThread(NULL, 0, mix_main, NULL, 0, &mix_thread_id);
+    SetThreadPriority(thread, THREAD_PRIORITY_HIGHEST);
+    CloseHandle(thread);
+
+    log_write(LOG_INFO, "mixer: %d x %d ms output at %d Hz\r\n", mix_buffers, mix_block_ms, MIX_RATE);
+    return 1;
+}
+
+MMRESULT WINAPI fake_waveOutOpen(LPHWAVEOUT phwo, UINT uDeviceID, LPCWAVEFORMATEX pwfx, DWORD dwCallback, DWORD dwInstance, DWORD fdwOpen)
+{
+    struct mix_stream *s = NULL;
+    int i;
+
+    if (!mix_enabled || !mix_supported(pwfx) || (fdwOpen & WAVE_FORMAT_DIRECT))
+        return real_waveOutOpen(phwo, uDeviceID, pwfx, dwCallback, dwInstance, fdwOpen);
+
+    if (fdwOpen & WAVE_FORMAT_QUERY)
+        return MMSYSERR_NOERROR;
+
+    EnterCriticalSection(&mix_cs);
+
+    for (i = 0; i < MIX_STREAMS && mix_output_open(); i++)
+    {
+        if (!mix_streams[i].used && !mix_streams[i].pending)
+        {
+            HANDLE drained = mix_streams[i].drained;
+
+            s = &mix_streams[i];
+            memset(s, 0, sizeof *s);
+            s->drained       = drained;
+            s->used          = 1;
+            s->block_align   = pwfx->nBlockAlign;
+            s->callback_type = fdwOpen;
+            s->callback      = dwCallback;
+            s->instance      = dwInstance;
+            s->volume        = 0xFFFFFFFF;
+            mix_conv_init(&s->conv, pwfx->nChannels, pwfx->wBitsPerSample, pwfx->nSamplesPerSec, MIX_RATE);
+            break;
+        }
+    }
+
+    LeaveCriticalSection(&mix_cs);
+
+    if (!s)
+        return real_waveOutOpen(phwo, uDeviceID, pwfx, dwCallback, dwInstance, fdwOpen);
+
+    *phwo = (HWAVEOUT)s;
+    mix_notify(*phwo, fdwOpen, dwCallback, dwInstance, WOM_OPEN, NULL);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutClose(HWAVEOUT hwo)
+{
+    struct mix_stream *s = mix_stream_of(hwo);
+    DWORD type, callback, instance;
+
+    if (!s)
+        return real_waveOutClose(hwo);
+
+    mix_drain(s);
+
+    EnterCriticalSection(&mix_cs);
+
+    if (!s->used || s->head || s->pending)
+    {
+        LeaveCriticalSection(&mix_cs);
+        return s->used ? WAVERR_STILLPLAYING : MMSYSERR_INVALHANDLE;
+    }
+
+    type     = s->callback_type;
+    callback = s->callback;
+    instance = s->instance;
+    s->used  = 0;
+
+    LeaveCriticalSection(&mix_cs);
+
+    mix_notify(hwo, type, callback, instance, WOM_CLOSE, NULL);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutPrepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutPrepareHeader(hwo, pwh, cbwh);
+
+    if (!pwh || cbwh < sizeof(WAVEHDR))
+        return MMSYSERR_INVALPARAM;
+
+    pwh->dwFlags |= WHDR_PREPARED;
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutUnprepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutUnprepareHeader(hwo, pwh, cbwh);
+
+    if (!pwh || cbwh < sizeof(WAVEHDR))
+        return MMSYSERR_INVALPARAM;
+
+    if (pwh->dwFlags & WHDR_INQUEUE)
+        return WAVERR_STILLPLAYING;
+
+    pwh->dwFlags &= ~WHDR_PREPARED;
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutWrite(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh)
+{
+    struct mix_stream *s = mix_stream_of(hwo);
+
+    if (!s)
+        return real_waveOutWrite(hwo, pwh, cbwh);
+
+    if (!pwh || cbwh < sizeof(WAVEHDR))
+        return MMSYSERR_INVALPARAM;
+
+    if (!(pwh->dwFlags & WHDR_PREPARED))
+        return WAVERR_UNPREPARED;
+
+    if (pwh->dwFlags & WHDR_INQUEUE)
+        return WAVERR_STILLPLAYING;
+
+    pwh->dwFlags = (pwh->dwFlags & ~WHDR_DONE) | WHDR_INQUEUE;
+    pwh->lpNext  = NULL;
+
+    EnterCriticalSection(&mix_cs);
+
+    if (s->tail)
+        s->tail->lpNext = pwh;
+    else
+        s->head = pwh;
+
+    s->tail = pwh;
+
+    LeaveCriticalSection(&mix_cs);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutPause(HWAVEOUT hwo)
+{
+    struct mix_stream *s = mix_stream_of(hwo);
+
+    if (!s)
+        return real_waveOutPause(hwo);
+
+    EnterCriticalSection(&mix_cs);
+    s->paused = 1;
+    LeaveCriticalSection(&mix_cs);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutRestart(HWAVEOUT hwo)
+{
+    struct mix_stream *s = mix_stream_of(hwo);
+
+    if (!s)
+        return real_waveOutRestart(hwo);
+
+    EnterCriticalSection(&mix_cs);
+    s->paused = 0;
+    LeaveCriticalSection(&mix_cs);
+
+    return MMSYSERR_NOERROR;
+}
+
+/* returns every queued buffer and rewinds the position, the caller can
+ * unprepare all of them as soon as this returns */
+MMRESULT WINAPI fake_waveOutReset(HWAVEOUT hwo)
+{
+    struct mix_stream *s = mix_stream_of(hwo);
+    WAVEHDR *done = NULL, **done_tail = &done;
+
+    if (!s)
+        return real_waveOutReset(hwo);
+
+    EnterCriticalSection(&mix_cs);
+
+    while (s->head)
+        mix_retire(s, &done_tail);
+
+    s->position = 0;
+    mix_conv_reset(&s->conv);
+
+    LeaveCriticalSection(&mix_cs);
+
+    mix_finish(done);
+    mix_drain(s);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutGetPosition(HWAVEOUT hwo, LPMMTIME pmmt, UINT cbmmt)
+{
+    struct mix_stream *s = mix_stream_of(hwo);
+
+    if (!s)
+        return real_waveOutGetPosition(hwo, pmmt, cbmmt);
+
+    if (!pmmt || cbmmt < sizeof(MMTIME))
+        return MMSYSERR_INVALPARAM;
+
+    if (pmmt->wType == TIME_SAMPLES)
+    {
+        pmmt->u.sample = s->position / s->block_align;
+    }
+    else
+    {
+        pmmt->wType = TIME_BYTES;
+        pmmt->u.cb  = s->position;
+    }
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutGetVolume(HWAVEOUT hwo, PDWORD pdwVolume)
+{
+    struct mix_stream *s = mix_stream_of(hwo);
+
+    if (!s)
+        return real_waveOutGetVolume(hwo, pdwVolume);
+
+    if (!pdwVolume)
+        return MMSYSERR_INVALPARAM;
+
+    *pdwVolume = s->volume;
+
+    return MMSYSERR_NOERROR;
+}
+
+/* per stream when mixing, the real call changes the whole session */
+MMRESULT WINAPI fake_waveOutSetVolume(HWAVEOUT hwo, DWORD dwVolume)
+{
+    struct mix_stream *s = mix_stream_of(hwo);
+
+    if (!s)
+        return real_waveOutSetVolume(hwo, dwVolume);
+
+    EnterCriticalSection(&mix_cs);
+    s->volume = dwVolume;
+    mix_conv_volume(&s->conv, dwVolume);
+    LeaveCriticalSection(&mix_cs);
+
+    return MMSYSERR_NOERROR;
+}
+
+/* the device the shared output went to */
+MMRESULT WINAPI fake_waveOutGetID(HWAVEOUT hwo, LPUINT puDeviceID)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutGetID(hwo, puDeviceID);
+
+    return real_waveOutGetID(mix_hwo, puDeviceID);
+}
+
+/* driver messages go to the shared output, there is no device per stream */
+MMRESULT WINAPI fake_waveOutMessage(HWAVEOUT hwo, UINT uMsg, DWORD dw1, DWORD dw2)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutMessage(hwo, uMsg, dw1, dw2);
+
+    return real_waveOutMessage(mix_hwo, uMsg, dw1, dw2);
+}
+
+/* loops are played once when mixing, there is none to break */
+MMRESULT WINAPI fake_waveOutBreakLoop(HWAVEOUT hwo)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutBreakLoop(hwo);
+
+    return MMSYSERR_NOERROR;
+}
+
+MMRESULT WINAPI fake_waveOutGetPitch(HWAVEOUT hwo, PDWORD pdwPitch)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutGetPitch(hwo, pdwPitch);
+
+    return MMSYSERR_NOTSUPPORTED;
+}
+
+MMRESULT WINAPI fake_waveOutSetPitch(HWAVEOUT hwo, DWORD dwPitch)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutSetPitch(hwo, dwPitch);
+
+    return MMSYSERR_NOTSUPPORTED;
+}
+
+MMRESULT WINAPI fake_waveOutGetPlaybackRate(HWAVEOUT hwo, PDWORD pdwRate)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutGetPlaybackRate(hwo, pdwRate);
+
+    return MMSYSERR_NOTSUPPORTED;
+}
+
+MMRESULT WINAPI fake_waveOutSetPlaybackRate(HWAVEOUT hwo, DWORD dwRate)
+{
+    if (!mix_stream_of(hwo))
+        return real_waveOutSetPlaybackRate(hwo, dwRate);
+
+    return MMSYSERR_NOTSUPPORTED;
+}
@@ -0,0 +1,24 @@
+/* Optional software mixer for the game's waveOut streams and the music, see
+ * mixer.c. The fake_waveOut functions are the DLL's exports, the player goes
+ * through them too so the music is just another stream when mixing. */
+
+void mix_config(int block_ms, int buffers);
+
+MMRESULT WINAPI fake_waveOutOpen(LPHWAVEOUT phwo, UINT uDeviceID, LPCWAVEFORMATEX pwfx, DWORD dwCallback, DWORD dwInstance, DWORD fdwOpen);
+MMRESULT WINAPI fake_waveOutClose(HWAVEOUT hwo);
+MMRESULT WINAPI fake_waveOutPrepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh);
+MMRESULT WINAPI fake_waveOutUnprepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh);
+MMRESULT WINAPI fake_waveOutWrite(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh);
+MMRESULT WINAPI fake_waveOutPause(HWAVEOUT hwo);
+MMRESULT WINAPI fake_waveOutRestart(HWAVEOUT hwo);
+MMRESULT WINAPI fake_waveOutReset(HWAVEOUT hwo);
+MMRESULT WINAPI fake_waveOutGetPosition(HWAVEOUT hwo, LPMMTIME pmmt, UINT cbmmt);
+MMRESULT WINAPI fake_waveOutGetVolume(HWAVEOUT hwo, PDWORD pdwVolume);
+MMRESULT WINAPI fake_waveOutSetVolume(HWAVEOUT hwo, DWORD dwVolume);
+MMRESULT WINAPI fake_waveOutGetID(HWAVEOUT hwo, LPUINT puDeviceID);
+MMRESULT WINAPI fake_waveOutMessage(HWAVEOUT hwo, UINT uMsg, DWORD dw1, DWORD dw2);
+MMRESULT WINAPI fake_waveOutBreakLoop(HWAVEOUT hwo);
+MMRESULT WINAPI fake_waveOutGetPitch(HWAVEOUT hwo, PDWORD pdwPitch);
+MMRESULT WINAPI fake_waveOutSetPitch(HWAVEOUT hwo, DWORD dwPitch);
+MMRESULT WINAPI fake_waveOutGetPlaybackRate(HWAVEOUT hwo, PDWORD pdwRate);
+MMRESULT WINAPI fake_waveOutSetPlaybackRate(HWAVEOUT hwo, DWORD dwRate);
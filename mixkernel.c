@@ -0,0 +1,161 @@
+#include "mixkernel.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define MIX_SSE2
+#endif
+
+void mix_conv_init(struct mix_conv *c, int channels, int bits, int rate, int out_rate)
+{
+    c->channels = channels;
+    c->bits     = bits;
+    c->step     = (uint32_t)(((uint64_t)rate << 16) / out_rate);
+    c->vol[0]   = c->vol[1] = 0x10000;
+    mix_conv_reset(c);
+}
+
+/* forgets the interpolation history, the next frame starts from silence */
+void mix_conv_reset(struct mix_conv *c)
+{
+    c->frac = 0x10000;
+    c->prev[0] = c->prev[1] = 0;
+    c->cur[0] = c->cur[1] = 0;
+}
+
+/* takes a waveOutSetVolume() value: left in the low word, right in the high */
+void mix_conv_volume(struct mix_conv *c, uint32_t volume)
+{
+    uint32_t left = volume & 0xFFFF, right = volume >> 16;
+
+    c->vol[0] = left + (left >> 15);
+    c->vol[1] = right + (right >> 15);
+}
+
+static inline void mix_read(struct mix_conv *c, const uint8_t *src)
+{
+    c->prev[0] = c->cur[0];
+    c->prev[1] = c->cur[1];
+
+    if (c->bits == 8)
+    {
+        c->cur[0] = (src[0] - 128) * 256;
+        c->cur[1] = c->channels == 2 ? (src[1] - 128) * 256 : c->cur[0];
+    }
+    else
+    {
+        const int16_t *s = (const int16_t *)src;
+        c->cur[0] = s[0];
+        c->cur[1] = c->channels == 2 ? s[1] : c->cur[0];
+    }
+}
+
+/* Converts up to dst_frames output frames, linearly interpolating between
+ * source frames. Stops early when the source runs out, 'used' is the number
+ * of source frames consumed. The converter keeps its position, so the next
+ * buffer of the stream continues without a click. */
+int mix_convert(struct mix_conv *c, const uint8_t *src, int src_frames, int *used, int16_t *dst, int dst_frames)
+{
+    int frame_size = c->channels * c->bits / 8;
+    int in = 0, out = 0, ch;
+
+    while (out < dst_frames)
+    {
+        while (c->frac >= 0x10000)
+        {
+            if (in == src_frames)
+                goto done;
+
+            mix_read(c, src + in * frame_size);
+            in++;
+            c->frac -= 0x10000;
+        }
+
+        for (ch = 0; ch < 2; ch++)
+        {
+            int32_t d = c->cur[ch] - c->prev[ch];
+            int32_t s = c->prev[ch] + ((d * (int32_t)(c->frac >> 1)) >> 15);
+            *dst++ = (int16_t)((s * c->vol[ch]) >> 16);
+        }
+
+        out++;
+        c->frac += c->step;
+    }
+
+done:
+    *used = in;
+    return out;
+}
+
+void mix_accumulate_scalar(int32_t *acc, const int16_t *src, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        acc[i] += src[i];
+}
+
+void mix_pack_scalar(int16_t *dst, const int32_t *acc, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        dst[i] = acc[i] > 32767 ? 32767 : acc[i] < -32768 ? -32768 : acc[i];
+}
+
+#ifdef MIX_SSE2
+/* 8 samples per iteration, sign extended to 32 bits by unpacking each sample
+ * into the high half and shifting it back down */
+__attribute__((target("sse2")))
+static void mix_accumulate_sse2(int32_t *acc, const int16_t *src, int n)
+{
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m128i s  = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        __m128i *a = (__m128i *)(acc + i);
+
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), lo));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), hi));
+    }
+
+    mix_accumulate_scalar(acc + i, src + i, n - i);
+}
+
+/* packssdw saturates to 16 bits, which is exactly the clipping we want */
+__attribute__((target("sse2")))
+static void mix_pack_sse2(int16_t *dst, const int32_t *acc, int n)
+{
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(acc + i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(acc + i + 4));
+
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(lo, hi));
+    }
+
+    mix_pack_scalar(dst + i, acc + i, n - i);
+}
+#endif
+
+void (*mix_accumulate)(int32_t *acc, const int16_t *src, int n) = mix_accumulate_scalar;
+void (*mix_pack)(int16_t *dst, const int32_t *acc, int n) = mix_pack_scalar;
+
+/* picks the SSE2 kernels when the CPU has them, 32-bit builds run on
+ * machines old enough not to */
+void mix_kernel_init()
+{
+#ifdef MIX_SSE2
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        mix_accumulate = mix_accumulate_sse2;
+        mix_pack = mix_pack_sse2;
+    }
+#endif
+}
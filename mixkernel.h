@@ -0,0 +1,30 @@
+/* Format conversion and mixing for the software mixer, see mixer.c. Plain C
+ * without Win32 so tools/mixbench can build it natively. Mixed audio is
+ * interleaved 16-bit stereo at the output rate, summed in 32 bits. */
+
+#include <stdint.h>
+
+/* per-stream converter from 8/16-bit mono/stereo PCM at any rate */
+struct mix_conv
+{
+    int         channels;
+    int         bits;
+    uint32_t    step;       /* source frames per output frame, 16.16 */
+    uint32_t    frac;       /* position between prev and cur, 16.16 */
+    int32_t     prev[2];
+    int32_t     cur[2];
+    int32_t     vol[2];     /* 0 - 0x10000 */
+};
+
+void mix_conv_init(struct mix_conv *c, int channels, int bits, int rate, int out_rate);
+void mix_conv_reset(struct mix_conv *c);
+void mix_conv_volume(struct mix_conv *c, uint32_t volume);
+int mix_convert(struct mix_conv *c, const uint8_t *src, int src_frames, int *used, int16_t *dst, int dst_frames);
+
+/* n is in samples, not frames */
+void mix_accumulate_scalar(int32_t *acc, const int16_t *src, int n);
+void mix_pack_scalar(int16_t *dst, const int32_t *acc, int n);
+
+void mix_kernel_init();
+extern void (*mix_accumulate)(int32_t *acc, const int16_t *src, int n);
+extern void (*mix_pack)(int16_t *dst, const int32_t *acc, int n);
@@ -0,0 +1,73 @@
+#include <windows.h>
+#include "core.h"
+#include "notify.h"
+
+#define NOTIFY_QUEUE    16
+
+/* MM_MCINOTIFY messages are queued here and posted by their own thread, so
+ * neither the game thread nor the player thread ever waits on the game's
+ * message pump. */
+
+struct notify_msg
+{
+    HWND    hwnd;
+    WPARAM  status;
+};
+
+static struct notify_msg notify_queue[NOTIFY_QUEUE];
+static int              notify_head     = 0;
+static int              notify_tail     = 0;
+static CRITICAL_SECTION notify_cs;
+static HANDLE           notify_ev       = NULL;
+
+static DWORD WINAPI notify_main(LPVOID unused)
+{
+    while (1)
+    {
+        WaitForSingleObject(notify_ev, INFINITE);
+
+        while (1)
+        {
+            struct notify_msg msg;
+
+            EnterCriticalSection(&notify_cs);
+            if (notify_head == notify_tail)
+            {
+                LeaveCriticalSection(&notify_cs);
+                break;
+            }
+            msg = notify_queue[notify_tail];
+            notify_tail = (notify_tail + 1) % NOTIFY_QUEUE;
+            LeaveCriticalSection(&notify_cs);
+
+            PostMessageA(msg.hwnd, MM_MCINOTIFY, msg.status, MAGIC_DEVICEID);
+        }
+    }
+
+    return 0;
+}
+
+void notify_init()
+{
+    InitializeCriticalSection(&notify_cs);
+    notify_ev = CreateEvent(NULL, FALSE, FALSE, NULL);
+    CreateThread(NULL, 0, notify_main, NULL, 0, NULL);
+}
+
+/* hwnd is the dwCallback of the command that asked for the notification */
+void notify_post(HWND hwnd, WPARAM status)
+{
+    EnterCriticalSection(&notify_cs);
+
+    notify_queue[notify_head].hwnd   = hwnd;
+    notify_queue[notify_head].status = status;
+    notify_head = (notify_head + 1) % NOTIFY_QUEUE;
+
+    /* a game that stopped pumping messages loses the oldest ones */
+    if (notify_head == notify_tail)
+        notify_tail = (notify_tail + 1) % NOTIFY_QUEUE;
+
+    LeaveCriticalSection(&notify_cs);
+
+    SetEvent(notify_ev);
+}
@@ -0,0 +1,2 @@
+void notify_init();
+void notify_post(HWND hwnd, WPARAM status);
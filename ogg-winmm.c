@@ -19,194 +19,171 @@
 #include <windows.h>
 #include <winreg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <dirent.h>
 #include <string.h>
 #include "player.h"
+#include "core.h"
+#include "catalog.h"
+#include "playlist.h"
+#include "trace.h"
+#include "notify.h"
+#include "stats.h"
+#include "log.h"
+#include "stubs.h"
+#include "mixer.h"
 
-#define MAGIC_DEVICEID 0xBEEF
-#define MAX_TRACKS 99
+char music_path[2048];
+
+MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam);
 
-struct track_info
+BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 {
-    char path[MAX_PATH];    /* full path to ogg */
-    unsigned int length;    /* seconds */
-    unsigned int position;  /* seconds */
-};
+    if (fdwReason == DLL_PROCESS_ATTACH)
+    {
+        static const struct core_host host = { fake_mciSendCommandA, notify_post };
 
-static struct track_info tracks[MAX_TRACKS];
+        stat_init();
+        notify_init();
+        plr_init();
+        core_init(&host);
 
-struct play_info
-{
-    int first;
-    int last;
-};
+        GetModuleFileName(hinstDLL, music_path, sizeof music_path);
+
+        char *last = strrchr(music_path, '\\');
+        if (last)
+        {
+            *last = '\0';
+        }
+
+        char ini_path[sizeof music_path + 16];
+        snprintf(ini_path, sizeof ini_path, "%s\\wgmus.ini", music_path);
 
 #ifdef _DEBUG
-    #define dprintf(...) if (fh) { fprintf(fh, __VA_ARGS__); fflush(NULL); }
-    FILE *fh = NULL;
-#else
-    #define dprintf(...)
+        log_open("winmm.log", GetPrivateProfileInt("Debug", "LogLevel", LOG_DEBUG, ini_path)); /* Renamed to .log*/
 #endif
 
-int playloop = 0;
-int current  = 1;
-int opened = 0;
-int paused = 0;
-int stopped = 0;
-int closed = 0;
-int notify = 0;
-int playing = 0;
-int notready = 1;
-HANDLE player = NULL;
-int firstTrack = -1;
-int lastTrack = 0;
-int numTracks = 1; /* +1 for data track on mixed mode cd's */
-DWORD dwCurTimeFormat = -1;
-char music_path[2048];
-int time_format = MCI_FORMAT_TMSF;
-CRITICAL_SECTION cs;
-char alias_s[100] = "cdaudio";
-static struct play_info info = { -1, -1 };
-
-int AudioLibrary;
-int FileFormat;
-int PlaybackMode;
-char MusicFolder;
-char musfold[255];
-
-
-/* NOTE: The player is currently incapable of playing tracks from a specified
- * position. Instead it plays whole tracks only. Previous pause logic using
- * Sleep caused crackling sound and was not acceptable. Future plan is to add
- * proper seek commands to support playback from arbitrary positions on the track.
- */
- 
-int player_config(int AudioLibrary, int FileFormat, int PlaybackMode, char MusicFolder)
-{
-	TCHAR ConfigFileNameFullPath3[MAX_PATH];
-	LPCSTR ConfigFileName3 = "wgmus.ini";
+        if (GetPrivateProfileInt("Debug", "Trace", 0, ini_path))
+            trace_open("mcitrace.bin");
 
-	*(strrchr(ConfigFileNameFullPath3, '\\')+1)=0;
-	strcat(ConfigFileNameFullPath3,ConfigFileName3);
-	
-	dprintf("where is our config file?:%s\r\n", ConfigFileNameFullPath3);
+        if (GetPrivateProfileInt("Debug", "ProfileForwards", 0, ini_path))
+            forward_profile_open();
 
-	AudioLibrary = GetPrivateProfileInt("Settings", "AudioLibrary", 0, ConfigFileNameFullPath3);
-	FileFormat = GetPrivateProfileInt("Settings", "FileFormat", 0, ConfigFileNameFullPath3);
-	PlaybackMode = GetPrivateProfileInt("Settings", "PlaybackMode", 0, ConfigFileNameFullPath3);
-	MusicFolder = GetPrivateProfileString("Settings", "MusicFolder", "tamus", musfold, MAX_PATH, ConfigFileNameFullPath3);
-	
-	return AudioLibrary, FileFOrmat, PlaybackMode, MusicFolder;
-}
- 
-int player_main(struct play_info *info)
-{
-    int first = info->first;
-    int last = info->last -1; /* -1 for plr logic */
-    if(last<first)last = first; /* manage plr logic */
-    current = first;
-    if(current<firstTrack)current = firstTrack;
-    dprintf("OGG Player logic: %d to %d\r\n", first, last);
-
-    while (current <= last && playing)
-    {
-        dprintf("Next track: %s\r\n", tracks[current].path);
-        plr_play(tracks[current].path);
+        /* LatencyProfile, BufferMs/MinBuffers/MaxBuffers override it */
+        char profile[32];
+        const struct plr_profile *lp = &plr_profiles[1];
+        GetPrivateProfileString("Settings", "LatencyProfile", "balanced", profile, sizeof profile, ini_path);
 
-        while (1)
+        for (int i = 0; plr_profiles[i].name; i++)
         {
-            if (plr_pump() == 0)
-                break;
+            if (!strcasecmp(profile, plr_profiles[i].name))
+                lp = &plr_profiles[i];
+        }
 
-            if (!playing)
-            {
-                return 0;
-            }
+        int block_ms = GetPrivateProfileInt("Settings", "BufferMs", lp->block_ms, ini_path);
+        int min_buffers = GetPrivateProfileInt("Settings", "MinBuffers", lp->min_buffers, ini_path);
+
+        plr_buffering(block_ms, min_buffers, GetPrivateProfileInt("Settings", "MaxBuffers", lp->max_buffers, ini_path));
+
+        /* the mixed output runs at the profile's base depth */
+        if (GetPrivateProfileInt("Settings", "Mixer", 0, ini_path))
+            mix_config(block_ms, min_buffers);
+
+        dprintf("TA-winmm latency profile %s\r\n", lp->name);
+
+        /* PlaybackMode 0 is CD mode with NN.ogg names, 1 is folder mode,
+         * 2 a disc image of one .ogg and a .cue */
+        static const char *mode_names[] = { "CD", "folder", "disc image" };
+        char folder[MAX_PATH], dll_dir[sizeof music_path];
+        int mode = GetPrivateProfileInt("Settings", "PlaybackMode", 0, ini_path);
+
+        if (mode < CATALOG_CD || mode > CATALOG_IMAGE)
+            mode = CATALOG_CD;
+        GetPrivateProfileString("Settings", "MusicFolder", "", folder, sizeof folder, ini_path);
+
+        strcpy(dll_dir, music_path);
+        if (folder[0])
+            snprintf(music_path, sizeof music_path, "%s\\%s", dll_dir, folder);
+
+        dprintf("TA-winmm music directory is %s, %s mode\r\n", music_path, mode_names[mode]);
+        dprintf("TA-winmm searching tracks...\r\n");
+
+        /* older installs keep the tracks next to the DLL */
+        int found = core_scan(music_path, mode);
+
+        if (!found && folder[0])
+        {
+            strcpy(music_path, dll_dir);
+            found = core_scan(music_path, mode);
         }
-        current++;
-    }
 
-    playloop = 0; /* IMPORTANT: Can not update the 'playing' variable from inside the 
-                     thread since it's tied to the threads while loop condition and
-                     can cause thread sync issues and a crash/deadlock. 
-                     (For example: 'WinQuake' startup) */
+        if (!found)
+            lprintf(LOG_ERROR, "TA-winmm found no tracks in %s\r\n", music_path);
 
-    /* Sending notify successful message:*/
-    if(notify && !paused)
-    {
-        dprintf("  Sending MCI_NOTIFY_SUCCESSFUL message...\r\n");
-        SendMessageA((HWND)0xffff, MM_MCINOTIFY, MCI_NOTIFY_SUCCESSFUL, 0xBEEF);
-        notify = 0;
-        /* NOTE: Notify message after successful playback is not working in Vista+.
-        MCI_STATUS_MODE does not update to show that the track is no longer playing.
-        Bug or broken design in mcicda.dll (also noted by the Wine team) */
-    }
-	player_config;
-    return 0;
-}
+        /* tracks copied into the folder while the game runs show up */
+        if (GetPrivateProfileInt("Settings", "WatchMusic", 1, ini_path) && !core_watch())
+            lprintf(LOG_WARN, "TA-winmm can't watch the music directory\r\n");
 
-BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
-{
-    if (fdwReason == DLL_PROCESS_ATTACH)
-    {
-#ifdef _DEBUG
-        fh = fopen("winmm.log", "w"); /* Renamed to .log*/
-#endif
-        GetModuleFileName(hinstDLL, music_path, sizeof music_path);
+        /* [Loops] has TrackNN=start,length in samples for music that
+         * should loop instead of ending, ahead of any loop tags */
+        char loops[2048];
+        char *l;
 
-        memset(tracks, 0, sizeof tracks);
+        core_loop_tags(GetPrivateProfileInt("Settings", "LoopTags", 0, ini_path));
+        plr_normalize(GetPrivateProfileInt("Settings", "Normalize", 0, ini_path));
+        plr_output_channels(GetPrivateProfileInt("Settings", "OutputChannels", 2, ini_path));
+        GetPrivateProfileSection("Loops", loops, sizeof loops, ini_path);
 
-        char *last = strrchr(music_path, '\\');
-        if (last)
+        for (l = loops; *l; l += strlen(l) + 1)
         {
-            *last = '\0';
+            long start, length;
+            int track;
+
+            if (sscanf(l, "Track%d=%ld,%ld", &track, &start, &length) == 3)
+                core_loop(track, start, length);
         }
-		const char *mF = &MusicFolder;
-        strncat(music_path, mF, sizeof music_path - 1);
 
-        dprintf("TA-winmm music directory is %s\r\n", music_path);
-        dprintf("TA-winmm searching tracks...\r\n");
+        /* folder mode can play ranges shuffled, or weighted by the file
+         * names in [Weights], like battle.ogg=3 */
+        static const char *order_names[] = { "sequential", "shuffle", "weighted" };
+        char order[32], weights[2048];
 
-        unsigned int position = 0;
+        GetPrivateProfileString("Settings", "PlaylistOrder", "sequential", order, sizeof order, ini_path);
 
-        for (int i = 1; i < MAX_TRACKS; i++) /* "Changed: int i = 0" to "1" we can skip track00.ogg" */
+        for (int i = 0; i < sizeof order_names / sizeof order_names[0]; i++)
         {
-			snprintf(tracks[i].path, sizeof tracks[i].path, "%s\\%02d.ogg", music_path, i);
-            tracks[i].length = plr_length(tracks[i].path);
-            tracks[i].position = position;
+            if (!strcasecmp(order, order_names[i]))
+                playlist_order(i);
+        }
 
-            if (tracks[i].length < 4)
-            {
-                tracks[i].path[0] = '\0';
-                position += 4; /* missing tracks are 4 second data tracks for us */
-            }
-            else
+        GetPrivateProfileSection("Weights", weights, sizeof weights, ini_path);
+
+        for (l = weights; *l; l += strlen(l) + 1)
+        {
+            char *eq = strchr(l, '=');
+
+            if (eq)
             {
-                if (firstTrack == -1)
-                {
-                    firstTrack = i;
-                }
-                if(i == numTracks) numTracks -= 1; /* Take into account pure music cd's starting with track01.ogg */
-
-                dprintf("Track %02d: %02d:%02d @ %d seconds\r\n", i, tracks[i].length / 60, tracks[i].length % 60, tracks[i].position);
-                numTracks++;
-                lastTrack = i;
-                position += tracks[i].length;
+                *eq = '\0';
+                playlist_weight(l, atoi(eq + 1));
+                *eq = '=';
             }
         }
+    }
 
-        dprintf("Emulating total of %d CD tracks.\r\n\r\n", numTracks);
+    if (fdwReason == DLL_PROCESS_DETACH)
+    {
+        core_unwatch(0);
+        trace_close();
+        stat_dump("winmm-stats.log");
+        forward_profile_dump("winmm-forwards.log");
     }
 
 #ifdef _DEBUG
     if (fdwReason == DLL_PROCESS_DETACH)
     {
-        if (fh)
-        {
-            fclose(fh);
-            fh = NULL;
-        }
+        log_close();
     }
 #endif
 
@@ -215,320 +192,229 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 
 /* MCI commands */
 /* https://docs.microsoft.com/windows/win32/multimedia/multimedia-commands */
-MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam)
+/* parms fields worth keeping in the trace, read after the call */
+static int trace_args(UINT uMsg, DWORD_PTR dwParam, uint32_t *arg)
 {
-    dprintf("mciSendCommandA(IDDevice=%p, uMsg=%p, fdwCommand=%p, dwParam=%p)\r\n", IDDevice, uMsg, &fdwCommand, &dwParam);
+    if (!dwParam)
+        return 0;
 
-    if (fdwCommand & MCI_NOTIFY)
+    if (uMsg == MCI_PLAY)
     {
+        MCI_PLAY_PARMS *parms = (MCI_PLAY_PARMS *)dwParam;
+        arg[0] = parms->dwFrom;
+        arg[1] = parms->dwTo;
+        return 2;
+    }
 
+    if (uMsg == MCI_SEEK)
+    {
+        arg[0] = ((MCI_SEEK_PARMS *)dwParam)->dwTo;
+        return 1;
     }
 
-    if (fdwCommand & MCI_WAIT)
+    if (uMsg == MCI_SET)
     {
+        arg[0] = ((MCI_SET_PARMS *)dwParam)->dwTimeFormat;
+        return 1;
+    }
 
+    if (uMsg == MCI_STATUS)
+    {
+        MCI_STATUS_PARMS *parms = (MCI_STATUS_PARMS *)dwParam;
+        arg[0] = parms->dwReturn;
+        arg[1] = parms->dwItem;
+        arg[2] = parms->dwTrack;
+        return 3;
     }
 
     if (uMsg == MCI_OPEN)
     {
-
+        arg[0] = ((MCI_OPEN_PARMS *)dwParam)->wDeviceID;
+        return 1;
     }
-	else
-    if (uMsg == MCI_SET)
-    {
-		
-	}
-	else
-    if (uMsg == MCI_CLOSE)
-    {
 
-    }
-	else
-    if (uMsg == MCI_PLAY)
-    {
+    return 0;
+}
 
-    }
-	else
-    if (uMsg == MCI_STOP)
+MCIERROR WINAPI fake_mciSendCommandA(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam)
+{
+    uint32_t arg[3];
+    uint64_t start = trace_enabled ? trace_begin() : 0;
+    uint64_t t0 = stat_ticks();
+    MCIERROR err = core_command(IDDevice, uMsg, fdwCommand, dwParam);
+
+    stat_inc(STAT_MCI_COMMANDS);
+    stat_record(HIST_MCI_COMMAND_US, stat_us(stat_ticks() - t0));
+
+    if (start)
+        trace_command(start, IDDevice, uMsg, fdwCommand, arg, trace_args(uMsg, dwParam, arg), err);
+
+    return err;
+}
+
+/* MCI command strings */
+/* https://docs.microsoft.com/windows/win32/multimedia/multimedia-command-strings */
+MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HANDLE hwndCallback)
+{
+    uint64_t start = trace_enabled ? trace_begin() : 0;
+    uint64_t t0;
+    MCIERROR err;
+
+    /* commands without a return value leave an empty string, like winmm */
+    if (ret && cchReturn)
+        ret[0] = '\0';
+
+    t0 = stat_ticks();
+    err = core_string(cmd, ret, cchReturn, hwndCallback);
+
+    stat_inc(STAT_MCI_STRINGS);
+    stat_record(HIST_MCI_STRING_US, stat_us(stat_ticks() - t0));
+
+    if (start)
+        trace_string(start, cmd, err ? NULL : ret, cchReturn, err);
+
+    return err;
+}
+
+/* Unicode entry points */
+/* Keywords, aliases and numbers are plain ASCII, so the wide calls are narrowed
+ * on the stack and run through the same code as the ANSI ones. Anything that
+ * does not fit (non-ASCII file names for other MCI devices) goes to the real
+ * winmm.dll untouched. */
+
+static int narrow_ascii(LPCWSTR src, char *dst, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
     {
+        if (src[i] > 0x7F)
+            return 0;
+
+        dst[i] = (char)src[i];
 
+        if (src[i] == 0)
+            return 1;
     }
-	else
-    if (uMsg == MCI_PAUSE)
+
+    return 0; /* too long */
+}
+
+static void widen_ascii(const char *src, LPWSTR dst, size_t size)
+{
+    size_t i;
+
+    if (!dst || size == 0)
+        return;
+
+    for (i = 0; i < size - 1 && src[i]; i++)
+        dst[i] = (unsigned char)src[i];
+
+    dst[i] = 0;
+}
+
+MCIERROR WINAPI fake_mciSendCommandW(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam)
+{
+    dprintf("mciSendCommandW(IDDevice=%d, uMsg=%08X, fdwCommand=%08X, dwParam=%p)\r\n", (int)IDDevice, uMsg, (unsigned)fdwCommand, (void *)dwParam);
+
+    if (uMsg == MCI_OPEN && dwParam)
     {
+        MCI_OPEN_PARMSW *parmsW = (MCI_OPEN_PARMSW *)dwParam;
+        MCI_OPEN_PARMSA parmsA;
+        char type[64], element[MAX_PATH], alias[100];
+
+        parmsA.dwCallback       = parmsW->dwCallback;
+        parmsA.wDeviceID        = parmsW->wDeviceID;
+        parmsA.lpstrDeviceType  = (LPCSTR)parmsW->lpstrDeviceType; /* MCI_OPEN_TYPE_ID passes an id here */
+        parmsA.lpstrElementName = NULL;
+        parmsA.lpstrAlias       = NULL;
+
+        if ((fdwCommand & MCI_OPEN_TYPE) && !(fdwCommand & MCI_OPEN_TYPE_ID) && parmsW->lpstrDeviceType)
+        {
+            if (!narrow_ascii(parmsW->lpstrDeviceType, type, sizeof type))
+                return real_mciSendCommandW(IDDevice, uMsg, fdwCommand, dwParam);
+            parmsA.lpstrDeviceType = type;
+        }
+
+        if ((fdwCommand & MCI_OPEN_ELEMENT) && parmsW->lpstrElementName)
+        {
+            if (!narrow_ascii(parmsW->lpstrElementName, element, sizeof element))
+                return real_mciSendCommandW(IDDevice, uMsg, fdwCommand, dwParam);
+            parmsA.lpstrElementName = element;
+        }
+
+        if ((fdwCommand & MCI_OPEN_ALIAS) && parmsW->lpstrAlias)
+        {
+            if (!narrow_ascii(parmsW->lpstrAlias, alias, sizeof alias))
+                return real_mciSendCommandW(IDDevice, uMsg, fdwCommand, dwParam);
+            parmsA.lpstrAlias = alias;
+        }
 
+        MCIERROR err = fake_mciSendCommandA(IDDevice, uMsg, fdwCommand, (DWORD_PTR)&parmsA);
+        parmsW->wDeviceID = parmsA.wDeviceID;
+        return err;
     }
-	else
-    if (uMsg == MCI_SYSINFO)
+
+    if (uMsg == MCI_SYSINFO && dwParam)
     {
+        MCI_SYSINFO_PARMSW *parmsW = (MCI_SYSINFO_PARMSW *)dwParam;
+        MCI_SYSINFO_PARMSA parmsA;
+        char buf[128] = "";
+
+        parmsA.dwCallback   = parmsW->dwCallback;
+        parmsA.lpstrReturn  = buf;
+        parmsA.dwRetSize    = sizeof buf;
+        parmsA.dwNumber     = parmsW->dwNumber;
+        parmsA.wDeviceType  = parmsW->wDeviceType;
+
+        MCIERROR err = fake_mciSendCommandA(IDDevice, uMsg, fdwCommand, (DWORD_PTR)&parmsA);
 
+        /* the core writes the quantity as a DWORD, not as text */
+        if (fdwCommand & MCI_SYSINFO_QUANTITY)
+        {
+            if (!err && parmsW->lpstrReturn && parmsW->dwRetSize >= sizeof(DWORD))
+                *(DWORD *)parmsW->lpstrReturn = *(DWORD *)buf;
+        }
+        else
+            widen_ascii(buf, parmsW->lpstrReturn, parmsW->dwRetSize);
+
+        return err;
     }
-	else
-	if (uMsg == MCI_INFO)
-	{
-		
-	}
-	else
-    if (uMsg == MCI_STATUS)
+
+    if (uMsg == MCI_INFO && dwParam)
     {
+        MCI_INFO_PARMSW *parmsW = (MCI_INFO_PARMSW *)dwParam;
+        MCI_INFO_PARMSA parmsA;
+        char buf[128] = "";
+
+        parmsA.dwCallback   = parmsW->dwCallback;
+        parmsA.lpstrReturn  = buf;
+        parmsA.dwRetSize    = sizeof buf;
+
+        MCIERROR err = fake_mciSendCommandA(IDDevice, uMsg, fdwCommand, (DWORD_PTR)&parmsA);
+        widen_ascii(buf, parmsW->lpstrReturn, parmsW->dwRetSize);
+        return err;
     }
 
-    /* fallback */
-    return MCIERR_UNRECOGNIZED_COMMAND;
+    /* everything else has the same layout in both variants */
+    return fake_mciSendCommandA(IDDevice, uMsg, fdwCommand, dwParam);
 }
 
-/* MCI command strings */
-/* https://docs.microsoft.com/windows/win32/multimedia/multimedia-command-strings */
-MCIERROR WINAPI fake_mciSendStringA(LPCTSTR cmd, LPTSTR ret, UINT cchReturn, HANDLE hwndCallback)
+MCIERROR WINAPI fake_mciSendStringW(LPCWSTR cmd, LPWSTR ret, UINT cchReturn, HWND hwndCallback)
 {
-	MCIERROR err;
-	if(TRUE) {
-		static char sPlayerNickName[80+1] = "";
-		char sNickName[80+1];
-		char sCommand[80+1];
-		char sDevice[80+1];
-		char *sCmdTarget;
-		DWORD dwCommand;
-		
-		DWORD dwNewTimeFormat = -1;
-		
-		char cmdbuf[1024];
-		char cmp_str[1024];
-
-		if(!strcmp(sCommand, "open")) dwCommand = MCI_OPEN; else
-		if(!strcmp(sCommand, "close")) dwCommand = MCI_CLOSE; else
-		if(!strcmp(sCommand, "stop")) dwCommand = MCI_STOP; else
-		if(!strcmp(sCommand, "pause")) dwCommand = MCI_PAUSE; else
-		if(!strcmp(sCommand, "resume")) dwCommand = MCI_RESUME; else
-		if(!strcmp(sCommand, "set")) dwCommand = MCI_SET; else
-		if(!strcmp(sCommand, "status")) dwCommand = MCI_STATUS; else
-		if(!strcmp(sCommand, "play")) dwCommand = MCI_PLAY; else
-		if(!strcmp(sCommand, "seek")) dwCommand = MCI_SEEK; else
-		if(!strcmp(sCommand, "capability")) dwCommand = MCI_GETDEVCAPS; else
-		dwCommand = 0; 
-		
-		if(dwCommand && (dwCommand != MCI_OPEN)){
-			// don't try to parse unknown commands, nor open command that
-			// doesn't necessarily have extra arguments
-			sCmdTarget = (char *)cmd;
-			while (*sCmdTarget && *sCmdTarget != ' ') sCmdTarget++; // skip command
-			while (*sCmdTarget && *sCmdTarget == ' ') sCmdTarget++; // skip first separator
-			while (*sCmdTarget && *sCmdTarget != ' ') sCmdTarget++; // skip deviceid
-			while (*sCmdTarget && *sCmdTarget == ' ') sCmdTarget++; // skip second separator
-		}
-
-		dprintf("[MCI String = %s]\n", cmd);
-
-		/* copy cmd into cmdbuf */
-		strcpy (cmdbuf,cmd);
-		/* change cmdbuf into lower case */
-		for (int i = 0; cmdbuf[i]; i++)
-		{
-			cmdbuf[i] = tolower(cmdbuf[i]);
-		}
-
-		if (strstr(cmd, "sysinfo cdaudio quantity"))
-		{
-			dprintf("  Returning quantity: 1\r\n");
-			strcpy(ret, "1");
-			return 0;
-		}
-
-		/* Example: "sysinfo cdaudio name 1 open" returns "cdaudio" or the alias.*/
-		if (strstr(cmd, "sysinfo cdaudio name"))
-		{
-			dprintf("  Returning name: cdaudio\r\n");
-			sprintf(ret, "%s", alias_s);
-			return 0;
-		}	
-
-		sprintf(cmp_str, "info %s", alias_s);
-		if (strstr(cmd, cmp_str))
-		{
-			fake_mciSendCommandA(MAGIC_DEVICEID, MCI_INFO, 0, (DWORD_PTR)NULL);
-			return 0;
-		}
-		
-		sprintf(cmp_str, "stop %s", alias_s);
-		if (strstr(cmd, cmp_str))
-		{
-			fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STOP, 0, (DWORD_PTR)NULL);
-			return 0;
-		}
-
-		sprintf(cmp_str, "pause %s", alias_s);
-		if (strstr(cmd, cmp_str))
-		{
-			fake_mciSendCommandA(MAGIC_DEVICEID, MCI_PAUSE, 0, (DWORD_PTR)NULL);
-			return 0;
-		}
-
-		sprintf(cmp_str, "open %s", alias_s);
-		if (strstr(cmd, cmp_str))
-		{
-			fake_mciSendCommandA(MAGIC_DEVICEID, MCI_OPEN, 0, (DWORD_PTR)NULL);
-			return 0;
-		}
-		
-		sprintf(cmp_str, "close %s", alias_s);
-		if (strstr(cmd, cmp_str))
-		{
-			fake_mciSendCommandA(MAGIC_DEVICEID, MCI_CLOSE, 0, (DWORD_PTR)NULL);
-			return 0;
-		}
-
-		/* Handle "set cdaudio/alias time format" */
-		sprintf(cmp_str, "set %s", alias_s);
-		if (strstr(cmd, cmp_str))
-		{
-			dwNewTimeFormat = -1;
-			if (strstr(cmd, "time format milliseconds"))
-			{
-				static MCI_SET_PARMS parms;
-				parms.dwTimeFormat = MCI_FORMAT_MILLISECONDS;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
-				dwNewTimeFormat = 1;
-				return 0;
-			}
-			else
-			if (strstr(cmd, "time format tmsf"))
-			{
-				static MCI_SET_PARMS parms;
-				parms.dwTimeFormat = MCI_FORMAT_TMSF;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
-				dwNewTimeFormat = 2;
-				return 0;
-			}
-			else
-			if (strstr(cmd, "time format msf"))
-			{
-				static MCI_SET_PARMS parms;
-				parms.dwTimeFormat = MCI_FORMAT_MSF;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&parms);
-				dwNewTimeFormat = 3;
-				return 0;
-			}
-			else
-			if (dwNewTimeFormat == -1)
-			{
-				dprintf("set time format failed\r\n");
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_CLOSE, 0, (DWORD_PTR)NULL);
-			}
-		}
-
-		/* Handle "status cdaudio/alias" */
-		sprintf(cmp_str, "status %s", alias_s);
-		if (strstr(cmd, cmp_str)){
-			if (strstr(cmd, "number of tracks"))
-			{
-				static MCI_STATUS_PARMS parms;
-				parms.dwItem = MCI_STATUS_NUMBER_OF_TRACKS;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_WAIT, (DWORD_PTR)&parms);
-				dprintf("  Returning number of tracks (%d)\r\n", numTracks);
-				sprintf(ret, "%d", numTracks);
-				return 0;
-			}
-			int track = 0;
-			if (sscanf(cmd, "status %*s length track %d", &track) == 1)
-			{
-				static MCI_STATUS_PARMS parms;
-				parms.dwItem = MCI_STATUS_LENGTH;
-				parms.dwTrack = track;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_TRACK|MCI_WAIT, (DWORD_PTR)&parms);
-				sprintf(ret, "%d", parms.dwReturn);
-				return 0;
-			}
-			if (strstr(cmd, "length"))
-			{
-				static MCI_STATUS_PARMS parms;
-				parms.dwItem = MCI_STATUS_LENGTH;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM, (DWORD_PTR)&parms);
-				sprintf(ret, "%d", parms.dwReturn);
-				return 0;
-			}
-			if (sscanf(cmd, "status %*s type track %d", &track) == 1)
-			{
-				static MCI_STATUS_PARMS parms;
-				parms.dwItem = MCI_CDA_STATUS_TYPE_TRACK;
-				parms.dwTrack = track;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_TRACK, (DWORD_PTR)&parms);
-				sprintf(ret, "%d", parms.dwReturn);
-				return 0;
-			}
-			if (sscanf(cmd, "status %*s position track %d", &track) == 1)
-			{
-				static MCI_STATUS_PARMS parms;
-				parms.dwItem = MCI_STATUS_POSITION;
-				parms.dwTrack = track;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_TRACK, (DWORD_PTR)&parms);
-				sprintf(ret, "%d", parms.dwReturn);
-				return 0;
-			}
-			if (strstr(cmd, "position"))
-			{
-				static MCI_STATUS_PARMS parms;
-				parms.dwItem = MCI_STATUS_POSITION;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM, (DWORD_PTR)&parms);
-				sprintf(ret, "%d", parms.dwReturn);
-				return 0;
-			}
-			if (strstr(cmd, "mode"))
-			{
-				static MCI_STATUS_PARMS parms;
-				parms.dwItem = MCI_STATUS_MODE;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_STATUS_MODE, (DWORD_PTR)&parms);
-				sprintf(ret, "%d", parms.dwReturn);
-				return 0;
-			}
-			if (strstr(cmd, "current"))
-			{
-				static MCI_STATUS_PARMS parms;
-				parms.dwItem = MCI_STATUS_CURRENT_TRACK;
-				parms.dwTrack = track;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM|MCI_TRACK, (DWORD_PTR)&parms);
-				sprintf(ret, "%d", parms.dwReturn);
-				return 0;
-			}
-			if (strstr(cmd, "media present"))
-			{
-				strcpy(ret, "TRUE");
-				return 0;
-			}
-		}
-
-		/* Handle "play cdaudio/alias" */
-		int from = -1, to = -1;
-		sprintf(cmp_str, "play %s", alias_s);
-		if (strstr(cmd, cmp_str))
-		{
-			if (strstr(cmd, "notify"))
-			{
-			notify = 1; /* storing the notify request */
-			}
-			if (sscanf(cmd, "play %*s from %d to %d", &from, &to) == 2)
-			{
-				static MCI_PLAY_PARMS parms;
-				parms.dwFrom = from;
-				parms.dwTo = to;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM|MCI_TO|MCI_NOTIFY, (DWORD_PTR)&parms);
-				return 0;
-			}
-			if (sscanf(cmd, "play %*s from %d", &from) == 1)
-			{
-				static MCI_PLAY_PARMS parms;
-				parms.dwFrom = from;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM, (DWORD_PTR)&parms);
-				return 0;
-			}
-			if (sscanf(cmd, "play %*s to %d", &to) == 1)
-			{
-				static MCI_PLAY_PARMS parms;
-				parms.dwTo = to;
-				fake_mciSendCommandA(MAGIC_DEVICEID, MCI_PLAY, MCI_TO, (DWORD_PTR)&parms);
-				return 0;
-			}
-		}
-	}
+    char cmdbuf[1024];
+    char retbuf[256] = "";
+
+    if (!cmd || !narrow_ascii(cmd, cmdbuf, sizeof cmdbuf))
+        return real_mciSendStringW(cmd, ret, cchReturn, hwndCallback);
+
+    if (cchReturn > sizeof retbuf)
+        cchReturn = sizeof retbuf;
+
+    MCIERROR err = fake_mciSendStringA(cmdbuf, retbuf, cchReturn, hwndCallback);
+
+    widen_ascii(retbuf, ret, cchReturn);
+
     return err;
 }
 
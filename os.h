@@ -0,0 +1,56 @@
+/* The few OS services the portable code needs: threads, an auto-reset event,
+ * a mutex, directory listing and watching, file mapping and a clock. os_win32.c goes into the DLL, os_posix.c into the
+ * native build. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct os_event *os_event;
+typedef struct os_mutex *os_mutex;
+typedef struct os_thread *os_thread;
+typedef struct os_watch *os_watch;
+
+os_event os_event_create(int signaled);
+void os_event_destroy(os_event ev);
+void os_event_set(os_event ev);
+int os_event_wait(os_event ev, int ms);     /* -1 waits forever, 0 on timeout */
+
+os_mutex os_mutex_create();
+void os_mutex_lock(os_mutex m);
+void os_mutex_unlock(os_mutex m);
+
+os_thread os_thread_start(int (*fn)(void *), void *arg, int high_priority);
+void os_thread_join(os_thread t);
+void os_thread_detach(os_thread t);         /* lets it run, t can't be used again */
+
+/* calls fn with the name of every file in dir, in no particular order;
+ * 0 if dir can't be read */
+int os_list_dir(const char *dir, void (*fn)(void *ctx, const char *name), void *ctx);
+
+/* Change notifications for the files in dir, NULL where the OS has none.
+ * os_watch_next() gives one changed name at a time: 1 with the name, 0 when
+ * ms pass without a change, -1 once the watch broke. An empty name means
+ * changes were lost and anything in dir may be different. */
+os_watch os_watch_open(const char *dir);
+int os_watch_next(os_watch w, char *name, int size, int ms);
+void os_watch_close(os_watch w);
+
+/* read-only view of a whole file, NULL if it can't be mapped */
+const void *os_map(const char *path, size_t *size);
+void os_unmap(const void *p, size_t size);
+
+uint64_t os_ticks();
+uint64_t os_ticks_per_sec();
+void os_sleep(int ms);
+
+/* gcc builtins, all four are locked instructions and full barriers on x86 */
+#define os_xchg(p, v)       __sync_lock_test_and_set((p), (v))
+#define os_cas(p, old, v)   __sync_val_compare_and_swap((p), (old), (v))
+#define os_add(p, v)        __sync_fetch_and_add((p), (v))
+#define os_load(p)          __sync_fetch_and_add((p), 0)
+
+#ifdef _WIN32
+#define OS_PATH_SEP "\\"
+#else
+#define OS_PATH_SEP "/"
+#endif
@@ -0,0 +1,294 @@
+#define _POSIX_C_SOURCE 200112L
+#include <pthread.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include "os.h"
+
+struct os_event
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             signaled;
+};
+
+struct os_mutex
+{
+    pthread_mutex_t lock;
+};
+
+struct os_thread
+{
+    pthread_t       thread;
+    int             (*fn)(void *);
+    void            *arg;
+};
+
+os_event os_event_create(int signaled)
+{
+    os_event ev = malloc(sizeof *ev);
+
+    pthread_mutex_init(&ev->lock, NULL);
+    pthread_cond_init(&ev->cond, NULL);
+    ev->signaled = signaled;
+
+    return ev;
+}
+
+void os_event_destroy(os_event ev)
+{
+    pthread_cond_destroy(&ev->cond);
+    pthread_mutex_destroy(&ev->lock);
+    free(ev);
+}
+
+void os_event_set(os_event ev)
+{
+    pthread_mutex_lock(&ev->lock);
+    ev->signaled = 1;
+    pthread_cond_signal(&ev->cond);
+    pthread_mutex_unlock(&ev->lock);
+}
+
+/* auto-reset like a Win32 event: a successful wait consumes the signal */
+int os_event_wait(os_event ev, int ms)
+{
+    struct timespec until;
+    int ret;
+
+    if (ms >= 0)
+    {
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec  += ms / 1000;
+        until.tv_nsec += (ms % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&ev->lock);
+
+    while (!ev->signaled)
+    {
+        if (ms < 0)
+            pthread_cond_wait(&ev->cond, &ev->lock);
+        else if (pthread_cond_timedwait(&ev->cond, &ev->lock, &until) == ETIMEDOUT)
+            break;
+    }
+
+    ret = ev->signaled;
+    ev->signaled = 0;
+
+    pthread_mutex_unlock(&ev->lock);
+
+    return ret;
+}
+
+os_mutex os_mutex_create()
+{
+    os_mutex m = malloc(sizeof *m);
+    pthread_mutex_init(&m->lock, NULL);
+    return m;
+}
+
+void os_mutex_lock(os_mutex m)
+{
+    pthread_mutex_lock(&m->lock);
+}
+
+void os_mutex_unlock(os_mutex m)
+{
+    pthread_mutex_unlock(&m->lock);
+}
+
+static void *os_thread_main(void *arg)
+{
+    os_thread t = arg;
+    t->fn(t->arg);
+    return NULL;
+}
+
+/* priority needs privileges on Linux, the native build only runs tools */
+os_thread os_thread_start(int (*fn)(void *), void *arg, int high_priority)
+{
+    os_thread t = malloc(sizeof *t);
+
+    t->fn  = fn;
+    t->arg = arg;
+
+    if (pthread_create(&t->thread, NULL, os_thread_main, t) != 0)
+    {
+        free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+void os_thread_join(os_thread t)
+{
+    pthread_join(t->thread, NULL);
+    free(t);
+}
+
+/* t stays allocated, the thread may not have read it yet */
+void os_thread_detach(os_thread t)
+{
+    pthread_detach(t->thread);
+}
+
+int os_list_dir(const char *dir, void (*fn)(void *ctx, const char *name), void *ctx)
+{
+    DIR *d = opendir(dir);
+    struct dirent *e;
+
+    if (!d)
+        return 0;
+
+    /* directories are left to the caller's name filter, d_type isn't portable */
+    while ((e = readdir(d)))
+    {
+        if (e->d_name[0] != '.')
+            fn(ctx, e->d_name);
+    }
+
+    closedir(d);
+    return 1;
+}
+
+#ifdef __linux__
+struct os_watch
+{
+    int     fd;
+    int     len;            /* bytes of events in buf */
+    int     off;            /* next event */
+    char    buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+};
+
+os_watch os_watch_open(const char *dir)
+{
+    os_watch w = calloc(1, sizeof *w);
+
+    w->fd = inotify_init();
+
+    if (w->fd < 0 || inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0)
+    {
+        if (w->fd >= 0)
+            close(w->fd);
+        free(w);
+        return NULL;
+    }
+
+    return w;
+}
+
+int os_watch_next(os_watch w, char *name, int size, int ms)
+{
+    struct inotify_event *e;
+
+    if (w->off >= w->len)
+    {
+        struct pollfd p = { w->fd, POLLIN, 0 };
+        int n = poll(&p, 1, ms);
+
+        if (n == 0 || (n < 0 && errno == EINTR))
+            return 0;
+
+        if (n < 0 || (w->len = read(w->fd, w->buf, sizeof w->buf)) <= 0)
+            return -1;
+
+        w->off = 0;
+    }
+
+    e = (struct inotify_event *)(w->buf + w->off);
+    w->off += sizeof *e + e->len;
+
+    /* IN_Q_OVERFLOW comes without a name, which is what it should mean */
+    snprintf(name, size, "%s", e->len ? e->name : "");
+    return 1;
+}
+
+void os_watch_close(os_watch w)
+{
+    if (!w)
+        return;
+
+    close(w->fd);
+    free(w);
+}
+#else
+os_watch os_watch_open(const char *dir)
+{
+    return NULL;
+}
+
+int os_watch_next(os_watch w, char *name, int size, int ms)
+{
+    return -1;
+}
+
+void os_watch_close(os_watch w)
+{
+}
+#endif
+
+const void *os_map(const char *path, size_t *size)
+{
+    struct stat st;
+    void *p;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    /* the mapping outlives the descriptor */
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED)
+        return NULL;
+
+    *size = st.st_size;
+    return p;
+}
+
+void os_unmap(const void *p, size_t size)
+{
+    munmap((void *)p, size);
+}
+
+uint64_t os_ticks()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t os_ticks_per_sec()
+{
+    return 1000000000;
+}
+
+void os_sleep(int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
@@ -0,0 +1,256 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "os.h"
+
+/* the handle types are opaque to callers, here they are the Win32 objects */
+
+os_event os_event_create(int signaled)
+{
+    return (os_event)CreateEvent(NULL, FALSE, signaled, NULL);
+}
+
+void os_event_destroy(os_event ev)
+{
+    CloseHandle((HANDLE)ev);
+}
+
+void os_event_set(os_event ev)
+{
+    SetEvent((HANDLE)ev);
+}
+
+int os_event_wait(os_event ev, int ms)
+{
+    return WaitForSingleObject((HANDLE)ev, ms < 0 ? INFINITE : (DWORD)ms) == WAIT_OBJECT_0;
+}
+
+os_mutex os_mutex_create()
+{
+    CRITICAL_SECTION *cs = malloc(sizeof *cs);
+    InitializeCriticalSection(cs);
+    return (os_mutex)cs;
+}
+
+void os_mutex_lock(os_mutex m)
+{
+    EnterCriticalSection((CRITICAL_SECTION *)m);
+}
+
+void os_mutex_unlock(os_mutex m)
+{
+    LeaveCriticalSection((CRITICAL_SECTION *)m);
+}
+
+struct os_start
+{
+    int (*fn)(void *);
+    void *arg;
+};
+
+/* the thread function is cdecl, CreateThread wants stdcall */
+static DWORD WINAPI os_thread_main(LPVOID p)
+{
+    struct os_start start = *(struct os_start *)p;
+
+    free(p);
+    return start.fn(start.arg);
+}
+
+os_thread os_thread_start(int (*fn)(void *), void *arg, int high_priority)
+{
+    struct os_start *start = malloc(sizeof *start);
+    HANDLE thread;
+
+    start->fn  = fn;
+    start->arg = arg;
+
+    thread = CreateThread(NULL, 0, os_thread_main, start, 0, NULL);
+
+    if (!thread)
+        free(start);
+    else if (high_priority)
+        SetThreadPriority(thread, THREAD_PRIORITY_HIGHEST);
+
+    return (os_thread)thread;
+}
+
+void os_thread_join(os_thread t)
+{
+    WaitForSingleObject((HANDLE)t, INFINITE);
+    CloseHandle((HANDLE)t);
+}
+
+void os_thread_detach(os_thread t)
+{
+    CloseHandle((HANDLE)t);
+}
+
+int os_list_dir(const char *dir, void (*fn)(void *ctx, const char *name), void *ctx)
+{
+    WIN32_FIND_DATAA fd;
+    char pattern[MAX_PATH];
+    HANDLE find;
+
+    snprintf(pattern, sizeof pattern, "%s\\*", dir);
+
+    find = FindFirstFileA(pattern, &fd);
+
+    if (find == INVALID_HANDLE_VALUE)
+        return 0;
+
+    do
+    {
+        if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            fn(ctx, fd.cFileName);
+    } while (FindNextFileA(find, &fd));
+
+    FindClose(find);
+    return 1;
+}
+
+struct os_watch
+{
+    HANDLE      dir;
+    OVERLAPPED  ov;
+    int         pending;        /* a ReadDirectoryChangesW is in flight */
+    DWORD       len;            /* bytes of records in buf */
+    DWORD       off;            /* next record */
+    DWORD       buf[4096];      /* FILE_NOTIFY_INFORMATION needs DWORD alignment */
+};
+
+os_watch os_watch_open(const char *dir)
+{
+    os_watch w = calloc(1, sizeof *w);
+
+    w->dir = CreateFileA(dir, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+
+    if (w->dir == INVALID_HANDLE_VALUE)
+    {
+        free(w);
+        return NULL;
+    }
+
+    w->ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    return w;
+}
+
+int os_watch_next(os_watch w, char *name, int size, int ms)
+{
+    FILE_NOTIFY_INFORMATION *fni;
+
+    if (w->off >= w->len)
+    {
+        if (!w->pending)
+        {
+            if (!ReadDirectoryChangesW(w->dir, w->buf, sizeof w->buf, FALSE,
+                FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE, NULL, &w->ov, NULL))
+                return -1;
+
+            w->pending = 1;
+        }
+
+        if (WaitForSingleObject(w->ov.hEvent, ms < 0 ? INFINITE : ms) != WAIT_OBJECT_0)
+            return 0;
+
+        w->pending = 0;
+        w->off = 0;
+
+        if (!GetOverlappedResult(w->dir, &w->ov, &w->len, FALSE))
+            return -1;
+
+        ResetEvent(w->ov.hEvent);
+
+        /* the buffer overflowed */
+        if (w->len == 0)
+        {
+            name[0] = '\0';
+            return 1;
+        }
+    }
+
+    fni = (FILE_NOTIFY_INFORMATION *)((char *)w->buf + w->off);
+    w->off = fni->NextEntryOffset ? w->off + fni->NextEntryOffset : w->len;
+
+    int n = WideCharToMultiByte(CP_ACP, 0, fni->FileName, fni->FileNameLength / sizeof(WCHAR), name, size - 1, NULL, NULL);
+    name[n] = '\0';
+    return 1;
+}
+
+void os_watch_close(os_watch w)
+{
+    if (!w)
+        return;
+
+    /* the kernel writes into w->buf until the cancelled read completes */
+    if (w->pending)
+    {
+        DWORD n;
+
+        CancelIo(w->dir);
+        GetOverlappedResult(w->dir, &w->ov, &n, TRUE);
+    }
+
+    CloseHandle(w->dir);
+    CloseHandle(w->ov.hEvent);
+    free(w);
+}
+
+const void *os_map(const char *path, size_t *size)
+{
+    HANDLE file, mapping;
+    LARGE_INTEGER len;
+    const void *p = NULL;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (GetFileSizeEx(file, &len) && len.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        /* the view keeps the mapping and the file open */
+        if (mapping)
+        {
+            p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+
+    if (p)
+        *size = (size_t)len.QuadPart;
+
+    return p;
+}
+
+void os_unmap(const void *p, size_t size)
+{
+    UnmapViewOfFile(p);
+}
+
+uint64_t os_ticks()
+{
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+uint64_t os_ticks_per_sec()
+{
+    static LARGE_INTEGER freq;
+
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+
+    return freq.QuadPart;
+}
+
+void os_sleep(int ms)
+{
+    Sleep(ms);
+}
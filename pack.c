@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "os.h"
+#include "player.h"
+#include "seek.h"
+#include "pack.h"
+
+/* The packed music archive. Opening it maps the file and checks the index,
+ * which has everything the catalog needs, so startup reads no Ogg data at
+ * all. The player reads the streams straight from the mapping.
+ *
+ * Tracks in the archive are named "<archive>#NN". Each one carries a seek
+ * table built when the archive was written, see seek.c, and its loudness
+ * gain, measured by decoding it then. The archive stays mapped
+ * until the process ends, the player may be reading any of it; a new one
+ * is picked up on the next start. */
+
+#define PACK_THREADS 4
+
+static char pack_path[260];
+static const unsigned char *pack_data = NULL;
+static size_t pack_size = 0;
+static const struct pack_entry *pack_entries = NULL;
+static int pack_count = 0;
+
+/* Maps the archive at path. Returns 1 if it is usable, also when it is the
+ * one already mapped. */
+int pack_open(const char *path)
+{
+    const struct pack_header *h;
+    const struct pack_entry *e;
+    const unsigned char *data;
+    size_t size;
+    uint32_t i;
+
+    if (pack_data)
+        return !strcmp(path, pack_path);
+
+    data = os_map(path, &size);
+
+    if (!data)
+        return 0;
+
+    h = (const struct pack_header *)data;
+    e = (const struct pack_entry *)(h + 1);
+
+    if (size < sizeof *h || memcmp(h->magic, PACK_MAGIC, sizeof h->magic) ||
+        h->count > (size - sizeof *h) / sizeof *e)
+    {
+        os_unmap(data, size);
+        return 0;
+    }
+
+    for (i = 0; i < h->count; i++)
+    {
+        if (e[i].offset > size || e[i].size > size - e[i].offset || e[i].seek_offset % 8 ||
+            e[i].seek_offset > size || e[i].seek_count > (size - e[i].seek_offset) / sizeof(struct seek_point))
+        {
+            os_unmap(data, size);
+            return 0;
+        }
+    }
+
+    snprintf(pack_path, sizeof pack_path, "%s", path);
+    pack_data = data;
+    pack_size = size;
+    pack_entries = e;
+    pack_count = h->count;
+
+    return 1;
+}
+
+/* for tools only, nothing may be playing from the archive */
+void pack_close()
+{
+    if (pack_data)
+        os_unmap(pack_data, pack_size);
+
+    pack_data = NULL;
+    pack_entries = NULL;
+    pack_count = 0;
+}
+
+/* the index of the mapped archive, returns the number of entries */
+int pack_index(const struct pack_entry **entries)
+{
+    *entries = pack_entries;
+    return pack_count;
+}
+
+/* the entry of a "<archive>#NN" track path, NULL for other paths */
+const struct pack_entry *pack_find(const char *path)
+{
+    size_t len = strlen(pack_path);
+    int i, track;
+
+    if (!pack_data || strncmp(path, pack_path, len) || path[len] != '#')
+        return NULL;
+
+    track = atoi(path + len + 1);
+
+    for (i = 0; i < pack_count; i++)
+    {
+        if (pack_entries[i].track == track)
+            return &pack_entries[i];
+    }
+
+    return NULL;
+}
+
+/* an offset from the index as a pointer into the mapping */
+const void *pack_at(uint64_t offset)
+{
+    return pack_data + offset;
+}
+
+/* tracks being measured for pack_write(), each thread takes the next one */
+struct pack_measure
+{
+    const char * const *files;
+    struct pack_entry *entries;
+    int count;
+    volatile int next;
+};
+
+static int pack_measure_main(void *arg)
+{
+    struct pack_measure *m = arg;
+    int i;
+
+    while ((i = os_add(&m->next, 1)) < m->count)
+        m->entries[i].gain = plr_measure(m->files[i]);
+
+    return 0;
+}
+
+/* Writes an archive of the files, tracks[i] being the track number of
+ * files[i], with a seek point every seek_ms, 0 for no tables. With measure
+ * every track is decoded for its gain, PACK_THREADS at a time. Returns 0
+ * if any of them can't be read or played. */
+int pack_write(const char *path, const char * const *files, const int *tracks, int count, int seek_ms, int measure)
+{
+    static const char pad[8];
+    struct pack_header h;
+    struct pack_entry *e = calloc(count ? count : 1, sizeof *e);
+    struct seek_point **tables = calloc(count ? count : 1, sizeof *tables);
+    const unsigned char **data = calloc(count ? count : 1, sizeof *data);
+    uint64_t offset = sizeof h + count * sizeof *e;
+    FILE *out = NULL;
+    int i, ok = 1;
+
+    for (i = 0; i < count && ok; i++)
+    {
+        size_t size = 0;
+        int rate;
+
+        data[i] = os_map(files[i], &size);
+
+        e[i].track = tracks[i];
+        e[i].samples = plr_length(files[i], &rate);
+        e[i].rate = rate;
+        e[i].offset = offset;
+        e[i].size = size;
+
+        if (!data[i] || !rate)
+        {
+            ok = 0;
+            break;
+        }
+
+        offset = (offset + size + 7) & ~(uint64_t)7;
+
+        e[i].seek_interval = seek_ms > 0 ? (uint32_t)((int64_t)rate * seek_ms / 1000) : 0;
+
+        if (e[i].seek_interval)
+        {
+            tables[i] = malloc((e[i].samples / e[i].seek_interval + 1) * sizeof **tables);
+            e[i].seek_count = seek_build(data[i], size, e[i].samples, e[i].seek_interval, tables[i]);
+        }
+
+        e[i].seek_offset = offset;
+        offset += e[i].seek_count * sizeof **tables;
+    }
+
+    if (ok && measure)
+    {
+        struct pack_measure m = { files, e, count, 0 };
+        os_thread threads[PACK_THREADS];
+
+        for (i = 0; i < PACK_THREADS; i++)
+            threads[i] = os_thread_start(pack_measure_main, &m, 0);
+
+        for (i = 0; i < PACK_THREADS; i++)
+        {
+            if (threads[i])
+                os_thread_join(threads[i]);
+        }
+
+        /* in case no thread could be started */
+        pack_measure_main(&m);
+    }
+
+    if (ok)
+        out = fopen(path, "wb");
+
+    if (out)
+    {
+        memcpy(h.magic, PACK_MAGIC, sizeof h.magic);
+        h.count = count;
+        h.reserved = 0;
+
+        ok &= fwrite(&h, sizeof h, 1, out) == 1;
+        ok &= fwrite(e, sizeof *e, count, out) == count;
+
+        for (i = 0; i < count && ok; i++)
+        {
+            ok &= fwrite(data[i], 1, e[i].size, out) == e[i].size;
+            ok &= fwrite(pad, 1, e[i].seek_offset - e[i].offset - e[i].size, out) == e[i].seek_offset - e[i].offset - e[i].size;
+            if (e[i].seek_count)
+                ok &= fwrite(tables[i], sizeof **tables, e[i].seek_count, out) == e[i].seek_count;
+        }
+
+        ok &= fclose(out) == 0;
+
+        if (!ok)
+            remove(path);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (data[i])
+            os_unmap(data[i], e[i].size);
+        free(tables[i]);
+    }
+
+    free(data);
+    free(tables);
+    free(e);
+
+    return ok && out;
+}
@@ -0,0 +1,38 @@
+/* music.pak, every track of the disc in one file, see pack.c */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PACK_NAME       "music.pak"
+#define PACK_MAGIC      "OGGPACK3"
+
+/* Little endian like both targets. The index follows the header and the
+ * streams follow the index, each one a complete Ogg file followed by its
+ * seek table, 8 byte aligned. */
+struct pack_header
+{
+    char magic[8];
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct pack_entry
+{
+    uint32_t track;
+    uint32_t rate;
+    int64_t samples;        /* length of the stream at rate */
+    uint64_t offset;        /* from the start of the archive */
+    uint64_t size;
+    uint64_t seek_offset;   /* struct seek_point[seek_count], see seek.h */
+    uint32_t seek_count;    /* 0 without a table */
+    uint32_t seek_interval; /* samples between the points */
+    int32_t gain;           /* hundredths of a dB to the reference loudness */
+    uint32_t reserved;
+};
+
+int pack_open(const char *path);
+void pack_close();
+int pack_index(const struct pack_entry **entries);
+const struct pack_entry *pack_find(const char *path);
+const void *pack_at(uint64_t offset);
+int pack_write(const char *path, const char * const *files, const int *tracks, int count, int seek_ms, int measure);
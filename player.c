@@ -1,47 +1,186 @@
 #include <vorbis/vorbisfile.h>
+#include <math.h>
 #include <stdio.h>
-#include <windows.h>
-
-WAVEFORMATEX    plr_fmt;
-HWAVEOUT        plr_hwo         = NULL;
-OggVorbis_File  plr_vf;
-HANDLE          plr_ev          = NULL;
-int             plr_cnt         = 0;
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "layout.h"
+#include "loudness.h"
+#include "os.h"
+#include "pack.h"
+#include "seek.h"
+#include "player.h"
+#include "sink.h"
+#include "stats.h"
+
+/* Two decoders, plr_next_vf has the track plr_preload() asked for, opened
+ * ahead of plr_play(), which then swaps the two. They can't be copied,
+ * vorbisfile keeps pointers into them. */
+OggVorbis_File  plr_files[2];
+OggVorbis_File  *plr_vf         = &plr_files[0];
+OggVorbis_File  *plr_next_vf    = &plr_files[1];
+char            plr_path[260];  /* file plr_vf has open */
+char            plr_next_path[260];
+int             plr_next_rate   = 0;
+int             plr_next_channels = 0;
+int             plr_next_pending = 0;   /* not opened yet */
+int             plr_next_ready  = 0;    /* the next track can be queued behind this one */
+const struct pack_entry *plr_track = NULL;     /* its archive entry, if any */
+int             plr_rate        = 44100;
+int             plr_channels    = 2;
+
+/* The device gets plr_out_channels, plr_output channels or with 0 the
+ * file's own; plr_conv converts when they differ. */
+int             plr_output      = 2;
+int             plr_out_channels = 2;
+struct layout   plr_conv;
+char            *plr_conv_buf   = NULL; /* one decoded block, set up by plr_play() */
+int             plr_conv_size   = 0;
+volatile int    plr_cnt         = 0;    /* blocks of the range queued */
 int             plr_vol         = 100;
-WAVEHDR         *plr_buffers[3] = { NULL, NULL, NULL };
+int             plr_norm        = 0;    /* apply track gains */
+float           plr_track_gain  = 1.0f;
+volatile int    plr_abort       = 0;
+
+/* Range being played in samples from the start of the track, plr_end is -1
+ * for the whole track. plr_written is where the last queued block ends, 32
+ * bits so plr_tell() can read it from another thread, and plr_last is how
+ * many samples that block has; only the last one of a range is short. */
+int64_t         plr_from        = 0;
+int64_t         plr_end         = -1;
+int64_t         plr_pos         = 0;
+volatile int32_t plr_written    = 0;
+int             plr_last        = 0;
+
+/* plr_play() numbers the ranges it starts in plr_ranges. When the device
+ * stays open the end of the previous range is still queued ahead of the new
+ * one: plr_tail blocks, up to plr_tail_end of that range, and plr_tell()
+ * goes by them until they have played. plr_seq is odd while the player
+ * thread changes anything plr_tell() reads, plr_tell() on another thread
+ * waits that out instead of reading half of the change. */
+volatile int32_t plr_seq        = 0;
+int             plr_ranges      = 0;
+int             plr_tail        = 0;
+int64_t         plr_tail_from   = 0;
+int32_t         plr_tail_end    = 0;
+int             plr_tail_last   = 0;
+
+/* Loop set by plr_loop(): reaching plr_loop_end continues at plr_loop_start
+ * in the same block, -1 when not looping. plr_loops counts the wraps. */
+int64_t         plr_loop_start  = 0;
+int64_t         plr_loop_end    = -1;
+volatile int    plr_loops       = 0;
+
+/* Output queue. Blocks are plr_block_ms long and up to plr_depth of them are
+ * queued on the device. The depth starts at plr_min_buffers, grows by one on
+ * every underrun and shrinks again after PLR_SHRINK_MS of clean playback. */
+#define PLR_SHRINK_MS 30000
+
+int             plr_block_ms    = 20;
+int             plr_min_buffers = 4;
+int             plr_max_buffers = 16;
+int             plr_depth       = 4;
+int             plr_underruns   = 0;
+int             plr_clean_ms    = 0;
+
+/* the second one is the default, tools/bench measures them all */
+const struct plr_profile plr_profiles[] =
+{
+    { "low",        10, 2,  8 },
+    { "balanced",   20, 4, 16 },
+    { "safe",       50, 6, 16 },
+    { NULL }
+};
 
-void plr_stop()
+void plr_init()
+{
+    layout_kernel_init();
+    sink_init();
+}
+
+/* Channels the device is opened with, 0 for as many as the file has. Only
+ * mono and stereo: the device gets a plain WAVEFORMATEX, which has no
+ * channel mask, so a wider layout would be heard in WAVE order. */
+void plr_output_channels(int channels)
+{
+    if (channels < 0 || channels > 2)
+        channels = 2;
+
+    plr_output = channels;
+}
+
+static int plr_out_of(int channels)
+{
+    return plr_output && channels <= LAYOUT_MAX_CHANNELS ? plr_output : channels;
+}
+
+void plr_buffering(int block_ms, int min_buffers, int max_buffers)
+{
+    if (block_ms < 5) block_ms = 5;
+    if (block_ms > 500) block_ms = 500;
+    if (min_buffers < 2) min_buffers = 2;
+    if (max_buffers > PLR_MAX_BUFFERS) max_buffers = PLR_MAX_BUFFERS;
+    if (max_buffers < min_buffers) max_buffers = min_buffers;
+
+    plr_block_ms    = block_ms;
+    plr_min_buffers = min_buffers;
+    plr_max_buffers = max_buffers;
+    plr_depth       = min_buffers;
+}
+
+/* queued audio in milliseconds and underruns since the DLL was loaded */
+void plr_stats(int *latency_ms, int *underruns)
+{
+    *latency_ms = plr_depth * plr_block_ms;
+    *underruns  = plr_underruns;
+}
+
+static void plr_close()
 {
     plr_cnt = 0;
 
-    if (plr_vf.datasource)
-        ov_clear(&plr_vf);
+    if (plr_vf->datasource)
+        ov_clear(plr_vf);
 
-    if (plr_ev)
-    {
-        CloseHandle(plr_ev);
-        plr_ev = NULL;
-    }
+    sink_close();
+}
 
-    if (plr_hwo)
-    {
-        waveOutReset(plr_hwo);
+static void plr_unload()
+{
+    if (plr_next_vf->datasource)
+        ov_clear(plr_next_vf);
 
-        int i;
-        for (i = 0; i < 3; i++)
-        {
-            if (plr_buffers[i] && plr_buffers[i]->dwFlags & WHDR_DONE)
-            {
-                waveOutUnprepareHeader(plr_hwo, plr_buffers[i], sizeof(WAVEHDR));
-                free(plr_buffers[i]->lpData);
-                free(plr_buffers[i]);
-                plr_buffers[i] = NULL;
-            }
-        }
+    plr_next_path[0] = '\0';
+    plr_next_pending = 0;
+    plr_next_ready = 0;
+}
 
-        waveOutClose(plr_hwo);
-        plr_hwo = NULL;
-    }
+void plr_stop()
+{
+    plr_close();
+    plr_unload();
+}
+
+/* Pause and resume may be called from any thread. The sink keeps the queued
+ * blocks and the decoder keeps its position, so resume continues from the
+ * exact sample without reopening or seeking anything. */
+void plr_pause()
+{
+    sink_pause();
+}
+
+void plr_resume()
+{
+    sink_resume();
+}
+
+/* Makes a running plr_pump() return as soon as possible: the decoder checks
+ * the flag between ov_read() chunks and the buffer wait is woken up. Called
+ * by the game thread on stop and close, cleared by the next plr_play(). */
+void plr_cancel()
+{
+    os_xchg(&plr_abort, 1);
+    sink_wake();
 }
 
 void plr_volume(int vol)
@@ -51,113 +190,271 @@ void plr_volume(int vol)
     plr_vol = vol;
 }
 
-int plr_length(const char *path)
+/* loudness normalization from the pack index or ReplayGain tags */
+void plr_normalize(int on)
 {
-    OggVorbis_File  vf;
+    plr_norm = on;
+}
 
-    if (ov_fopen(path, &vf) != 0)
-        return 0;
+/* volume control, kinda nasty; scale must not take a sample past full scale */
+void plr_gain(short *buf, int samples, float scale)
+{
+    int x;
 
-    int ret = (int)ov_time_total(&vf, -1);
+    for (x = 0; x < samples; x++)
+        buf[x] = buf[x] * scale;
+}
 
-    ov_clear(&vf);
+/* a stream in the mapped archive, read through ov_open_callbacks() */
+struct plr_mem
+{
+    const unsigned char *data;
+    size_t size;
+    size_t pos;
+};
 
-    return ret;
+static size_t plr_mem_read(void *ptr, size_t size, size_t nmemb, void *ds)
+{
+    struct plr_mem *m = ds;
+    size_t n = size ? (m->size - m->pos) / size : 0;
+
+    if (n > nmemb)
+        n = nmemb;
+
+    memcpy(ptr, m->data + m->pos, n * size);
+    m->pos += n * size;
+    return n;
 }
 
-int plr_play(const char *path)
+static int plr_mem_seek(void *ds, ogg_int64_t offset, int whence)
 {
-    plr_stop();
+    struct plr_mem *m = ds;
+    ogg_int64_t pos = whence == SEEK_CUR ? m->pos + offset : whence == SEEK_END ? m->size + offset : offset;
 
-    if (ov_fopen(path, &plr_vf) != 0)
-        return 0;
+    if (pos < 0 || pos > (ogg_int64_t)m->size)
+        return -1;
 
-    vorbis_info *vi = ov_info(&plr_vf, -1);
+    m->pos = (size_t)pos;
+    return 0;
+}
+
+static int plr_mem_close(void *ds)
+{
+    free(ds);
+    return 0;
+}
+
+static long plr_mem_tell(void *ds)
+{
+    return (long)((struct plr_mem *)ds)->pos;
+}
+
+/* opens a file, or a track of the archive without touching the disk */
+static int plr_open(const char *path, OggVorbis_File *vf)
+{
+    static const ov_callbacks mem_callbacks = { plr_mem_read, plr_mem_seek, plr_mem_close, plr_mem_tell };
+    const struct pack_entry *e = pack_find(path);
+    struct plr_mem *m;
 
-    if (!vi)
+    if (!e)
+        return ov_fopen(path, vf);
+
+    m = malloc(sizeof *m);
+
+    if (!m)
+        return -1;
+
+    m->data = pack_at(e->offset);
+    m->size = e->size;
+    m->pos = 0;
+
+    /* a failed open leaves the datasource to us */
+    if (ov_open_callbacks(m, vf, NULL, 0, mem_callbacks) != 0)
     {
-        ov_clear(&plr_vf);
-        return 0;
+        free(m);
+        return -1;
     }
 
-    plr_fmt.wFormatTag      = WAVE_FORMAT_PCM;
-    plr_fmt.nChannels       = vi->channels;
-    plr_fmt.nSamplesPerSec  = vi->rate;
-    plr_fmt.wBitsPerSample  = 16;
-    plr_fmt.nBlockAlign     = plr_fmt.nChannels * (plr_fmt.wBitsPerSample / 8);
-    plr_fmt.nAvgBytesPerSec = plr_fmt.nBlockAlign * plr_fmt.nSamplesPerSec;
-    plr_fmt.cbSize          = 0;
+    return 0;
+}
 
-    plr_ev = CreateEvent(NULL, 0, 1, NULL);
+/* the value of a Vorbis comment of the stream, NULL without it */
+static const char *plr_tag(OggVorbis_File *vf, const char *name)
+{
+    vorbis_comment *vc = vf->datasource ? ov_comment(vf, -1) : NULL;
+    size_t len = strlen(name);
+    int i;
 
-    if (waveOutOpen(&plr_hwo, WAVE_MAPPER, &plr_fmt, (DWORD_PTR)plr_ev, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+    for (i = 0; vc && i < vc->comments; i++)
     {
-        return 0;
+        if (!strncasecmp(vc->user_comments[i], name, len) && vc->user_comments[i][len] == '=')
+            return vc->user_comments[i] + len + 1;
     }
 
-    return 1;
+    return NULL;
 }
 
-int plr_pump()
+/* Track gain of the open file in hundredths of a dB: the measured one from
+ * the pack index, or REPLAYGAIN_TRACK_GAIN held back by
+ * REPLAYGAIN_TRACK_PEAK, never above 0 dB without a peak. */
+static int32_t plr_file_gain(OggVorbis_File *vf, const struct pack_entry *e)
 {
-    if (!plr_vf.datasource)
+    const char *gain = plr_tag(vf, "REPLAYGAIN_TRACK_GAIN"), *peak = plr_tag(vf, "REPLAYGAIN_TRACK_PEAK");
+    double db, limit = 0;
+
+    if (e)
+        return e->gain;
+
+    if (!gain)
         return 0;
 
-    int pos = 0;
-    int bufsize = plr_fmt.nAvgBytesPerSec / 4; /* 250ms (avg at 500ms) should be enough for everyone */
-    char *buf = malloc(bufsize);
+    db = strtod(gain, NULL);
 
-    while (pos < bufsize)
+    if (peak && strtod(peak, NULL) > 0)
+        limit = -20 * log10(strtod(peak, NULL));
+
+    return (int32_t)floor((db < limit ? db : limit) * 100);
+}
+
+/* Decodes all of path for the gain that brings it to the reference
+ * loudness, in hundredths of a dB; see loudness.c. Safe to call from
+ * several threads at once. */
+int32_t plr_measure(const char *path)
+{
+    static const int frames = 4096;
+    struct loudness *l = malloc(sizeof *l);
+    short *pcm = NULL;
+    OggVorbis_File vf;
+    vorbis_info *vi;
+    int32_t gain = 0;
+    long bytes;
+
+    if (!l || plr_open(path, &vf) != 0)
     {
-        long bytes = ov_read(&plr_vf, buf + pos, bufsize - pos, 0, 2, 1, NULL);
+        free(l);
+        return 0;
+    }
 
-        if (bytes == OV_HOLE)
+    if ((vi = ov_info(&vf, -1)) && (pcm = malloc(frames * vi->channels * sizeof *pcm)))
+    {
+        int frame = vi->channels * sizeof *pcm;
+
+        loud_init(l, vi->rate, vi->channels);
+
+        while ((bytes = ov_read(&vf, (char *)pcm, frames * frame, 0, 2, 1, NULL)) > 0 || bytes == OV_HOLE)
         {
-            free(buf);
-            continue;
+            if (bytes > 0)
+                loud_add(l, pcm, bytes / frame);
         }
 
-        if (bytes == OV_EBADLINK)
+        gain = loud_gain(l);
+    }
+
+    ov_clear(&vf);
+    free(pcm);
+    free(l);
+
+    return gain;
+}
+
+/* length in samples and the sample rate, 0 if the file can't be played */
+int64_t plr_length(const char *path, int *rate)
+{
+    OggVorbis_File  vf;
+    vorbis_info     *vi;
+    int64_t         ret = 0;
+
+    *rate = 0;
+
+    if (plr_open(path, &vf) != 0)
+        return 0;
+
+    vi = ov_info(&vf, -1);
+
+    if (vi && (ret = ov_pcm_total(&vf, -1)) > 0)
+        *rate = vi->rate;
+    else
+        ret = 0;
+
+    ov_clear(&vf);
+
+    return ret;
+}
+
+/* Moves the decoder to sample 'to'. Archive tracks jump to the page their
+ * seek table gives and decode the rest of the way, less than one interval;
+ * other files are bisected by libvorbisfile. */
+static int plr_seek(int64_t to)
+{
+    static char discard[4096];
+    const struct pack_entry *e = plr_track;
+    const struct seek_point *p = e && e->seek_count ? seek_find(pack_at(e->seek_offset), e->seek_count, e->seek_interval, to) : NULL;
+
+    if (p && ov_raw_seek(plr_vf, p->offset) == 0)
+    {
+        int frame = plr_channels * 2;
+        int64_t at = ov_pcm_tell(plr_vf);
+
+        while (at < to)
         {
-            free(buf);
-            return 0;
+            int64_t want = (to - at) * frame;
+            long bytes = ov_read(plr_vf, discard, want < sizeof discard ? (int)want : sizeof discard, 0, 2, 1, NULL);
+
+            if (bytes <= 0)
+                break;
+
+            at += bytes / frame;
         }
 
-        if (bytes == OV_EINVAL)
-        {
-            free(buf);
-            /* free(buf); */
+        if (at == to)
             return 0;
-        }
+    }
 
-        if (bytes == 0)
-        {
-            free(buf);
+    return ov_pcm_seek(plr_vf, to);
+}
 
-            int i, in_queue = 0;
-            for (i = 0; i < 3; i++)
-            {
-                if (plr_buffers[i] && plr_buffers[i]->dwFlags & WHDR_DONE)
-                {
-                    waveOutUnprepareHeader(plr_hwo, plr_buffers[i], sizeof(WAVEHDR));
-                    free(plr_buffers[i]->lpData);
-                    free(plr_buffers[i]);
-                    plr_buffers[i] = NULL;
-                }
-
-                if (plr_buffers[i])
-                    in_queue++;
-            }
+/* Plays samples [from, to) of the file, to -1 plays until its end. The
+ * file that is already open is kept, so the tracks of a disc image follow
+ * each other without opening it again, or even seeking when they are
+ * played in order. A file plr_preload() opened is taken from there, and if
+ * it has the format of the open device its first block is queued right
+ * behind the end of the previous track. */
+int plr_play(const char *path, int64_t from, int64_t to)
+{
+    int reopen = !plr_vf->datasource || strcmp(path, plr_path);
+    int next = reopen && plr_next_vf->datasource && !strcmp(path, plr_next_path);
+    int rate = plr_rate;
+    int keep = next && plr_vf->datasource && plr_next_rate == plr_rate && plr_out_of(plr_next_channels) == plr_out_channels;
 
-            Sleep(100);
+    plr_next_ready = 0;
 
-            return !(in_queue == 0);
-        }
+    if (keep)
+        ov_clear(plr_vf);
+    else if (reopen)
+        plr_close();
 
-        pos += bytes;
+    if (next)
+    {
+        OggVorbis_File *vf = plr_vf;
+
+        plr_vf = plr_next_vf;
+        plr_next_vf = vf;
+    }
+
+    if (reopen && !next)
+        plr_unload();
+
+    /* used up, whether it was opened or not */
+    if (!strcmp(path, plr_next_path))
+    {
+        plr_next_path[0] = '\0';
+        plr_next_pending = 0;
     }
 
-    /* Add volume override with "winmm.ini". */
+    os_xchg(&plr_abort, 0);
+
+    /* Add volume override with "winmm.ini". Read once per track since
+     * plr_pump() now runs every few milliseconds. */
     int ogg_winmm_vol = 100;
 
     FILE * fp;
@@ -180,73 +477,398 @@ int plr_pump()
         fclose(fp);
     }
 
-    /* volume control, kinda nasty */
+    if (reopen)
+    {
+        if (!next && plr_open(path, plr_vf) != 0)
+            return 0;
+
+        vorbis_info *vi = ov_info(plr_vf, -1);
+
+        if (!vi)
+        {
+            ov_clear(plr_vf);
+            return 0;
+        }
+
+        snprintf(plr_path, sizeof plr_path, "%s", path);
+        plr_track    = pack_find(path);
+        plr_track_gain = powf(10, plr_file_gain(plr_vf, plr_track) / 2000.0f);
+        rate         = vi->rate;
+        plr_channels = vi->channels;
+        plr_out_channels = plr_out_of(plr_channels);
+
+        if (plr_out_channels != plr_channels)
+            layout_matrix(&plr_conv, plr_channels, plr_out_channels);
+        plr_pos      = 0;
+    }
+
+    if (from != plr_pos && plr_seek(from) != 0)
+        from = plr_pos;
+
+    os_add(&plr_seq, 1);
+
+    /* a device opened again below has nothing queued */
+    plr_tail      = reopen && !keep ? 0 : sink_queued();
+    plr_tail_from = plr_from;
+    plr_tail_end  = plr_written;
+    plr_tail_last = plr_last;
+    plr_cnt       = 0;
+    plr_last      = 0;
+
+    plr_rate    = rate;
+    plr_from    = plr_pos = from;
+    plr_end     = to;
+    plr_written = (int32_t)from;
+    plr_ranges++;
+
+    plr_loop_end = -1;
+    plr_loops    = 0;
+
+    os_add(&plr_seq, 1);
 
-    int x, end = pos / 2;
-    short *sbuf = (short *)buf;
-    for (x = 0; x < end; x++)
-        sbuf[x] = sbuf[x] * (plr_vol / 100.0f);
-        
+    /* blocks that get converted are decoded into the same buffer every
+     * time, only the converted one is allocated for the device */
+    free(plr_conv_buf);
+    plr_conv_size = plr_out_channels != plr_channels ? plr_rate * plr_block_ms / 1000 * plr_channels * 2 : 0;
+    plr_conv_buf = plr_conv_size ? malloc(plr_conv_size) : NULL;
 
-    WAVEHDR *header = malloc(sizeof(WAVEHDR));
-    header->dwBufferLength   = pos;
-    header->lpData           = buf;
-    header->dwUser           = 0;
-    header->dwFlags          = plr_cnt == 0 ? WHDR_BEGINLOOP : 0;
-    header->dwLoops          = 0;
-    header->lpNext           = NULL;
-    header->reserved         = 0;
+    return reopen && !keep ? sink_open(plr_rate, plr_out_channels) : 1;
+}
 
-    waveOutPrepareHeader(plr_hwo, header, sizeof(WAVEHDR));
+/* number of the range the last plr_play() started, from the player thread */
+int plr_range()
+{
+    return plr_ranges;
+}
+
+/* The track that plays after the current one. plr_pump() opens it once the
+ * output queue is full, so plr_play() of it needn't open the file and its
+ * start can go on the device before the current one drained. */
+void plr_preload(const char *path)
+{
+    if (!strcmp(path, plr_next_path))
+        return;
+
+    plr_unload();
+    snprintf(plr_next_path, sizeof plr_next_path, "%s", path);
+    plr_next_pending = path[0] != '\0';
+}
+
+static void plr_load_next()
+{
+    const char *path = plr_next_path;
+    vorbis_info *vi;
 
-    if (plr_cnt > 1)
+    plr_next_pending = 0;
+
+    /* the next range of the same file, the decoder just carries on */
+    if (plr_vf->datasource && !strcmp(path, plr_path))
+    {
+        plr_next_ready = 1;
+        return;
+    }
+
+    if (plr_open(path, plr_next_vf) != 0)
+        return;
+
+    if (!(vi = ov_info(plr_next_vf, -1)))
     {
-        WaitForSingleObject(plr_ev, INFINITE);
+        ov_clear(plr_next_vf);
+        return;
     }
 
-    int i, queued = 0;
-    for (i = 0; i < 3; i++)
+    plr_next_rate     = vi->rate;
+    plr_next_channels = vi->channels;
+    plr_next_ready    = plr_next_rate == plr_rate && plr_out_of(plr_next_channels) == plr_out_channels;
+}
+
+/* Loops samples [start, end) of the open file from when playback gets to
+ * end. Called after plr_play(), which clears it. */
+void plr_loop(int64_t start, int64_t end)
+{
+    if (start < 0 || end <= start)
+        return;
+
+    os_add(&plr_seq, 1);
+
+    plr_loop_start = start;
+    plr_loop_end   = end;
+
+    os_add(&plr_seq, 1);
+}
+
+/* LOOPSTART and LOOPLENGTH, or LOOPEND, of the open file in samples; 0 if
+ * it has no loop */
+int plr_loop_tags(int64_t *start, int64_t *length)
+{
+    const char *s = plr_tag(plr_vf, "LOOPSTART"), *l = plr_tag(plr_vf, "LOOPLENGTH"), *e = plr_tag(plr_vf, "LOOPEND");
+    int64_t loop_start = s ? strtoll(s, NULL, 10) : -1;
+    int64_t loop_length = l ? strtoll(l, NULL, 10) : -1;
+    int64_t loop_end = e ? strtoll(e, NULL, 10) : -1;
+
+    if (loop_length < 0 && loop_end > loop_start)
+        loop_length = loop_end - loop_start;
+
+    if (loop_start < 0 || loop_length <= 0)
+        return 0;
+
+    *start = loop_start;
+    *length = loop_length;
+    return 1;
+}
+
+/* a block plr_pump() decoded into, unless it is the conversion buffer */
+static void plr_discard(char *buf)
+{
+    if (buf != plr_conv_buf)
+        free(buf);
+}
+
+int plr_pump()
+{
+    if (!plr_vf->datasource)
+        return 0;
+
+    int pos = 0;
+    int frame = plr_channels * 2;
+    int bufsize = plr_rate * plr_block_ms / 1000 * frame;
+    char *buf = plr_out_channels != plr_channels && plr_conv_buf && bufsize <= plr_conv_size ? plr_conv_buf : malloc(bufsize);
+    uint64_t t0 = stat_ticks();
+
+    if (!buf)
+        return 0;
+
+    while (pos < bufsize)
     {
-        if (plr_buffers[i] && plr_buffers[i]->dwFlags & WHDR_DONE)
+        if (plr_abort)
+        {
+            plr_discard(buf);
+            return 1;
+        }
+
+        long want = bufsize - pos;
+
+        /* back to the loop start within this block, the decoder stays open */
+        if (plr_loop_end >= 0 && plr_pos >= plr_loop_end)
+        {
+            int ok = plr_seek(plr_loop_start) == 0;
+
+            os_add(&plr_seq, 1);
+
+            if (!ok)
+            {
+                plr_loop_end = -1;
+                plr_loops = 0;
+            }
+            else
+            {
+                if (plr_from > plr_loop_start)
+                    plr_from = plr_loop_start;
+
+                plr_pos = plr_loop_start;
+                plr_loops++;
+            }
+
+            os_add(&plr_seq, 1);
+            continue;
+        }
+
+        /* stop at the end of the requested range or the loop */
+        int64_t end = plr_loop_end >= 0 ? plr_loop_end : plr_end;
+
+        if (end >= 0 && (end - plr_pos) * frame < want)
+            want = (long)(end - plr_pos) * frame;
+
+        long bytes = want > 0 ? ov_read(plr_vf, buf + pos, want, 0, 2, 1, NULL) : 0;
+
+        if (bytes == OV_HOLE)
+        {
+            continue;
+        }
+
+        if (bytes == OV_EBADLINK)
+        {
+            plr_discard(buf);
+            return 0;
+        }
+
+        if (bytes == OV_EINVAL)
         {
-            waveOutUnprepareHeader(plr_hwo, plr_buffers[i], sizeof(WAVEHDR));
-            free(plr_buffers[i]->lpData);
-            free(plr_buffers[i]);
-            plr_buffers[i] = NULL;
+            plr_discard(buf);
+            return 0;
         }
 
-        if (!queued && plr_buffers[i] == NULL)
+        /* a loop past the end of the file ends where the file does */
+        if (bytes == 0 && plr_loop_end >= 0 && plr_pos > plr_loop_start)
         {
-            waveOutWrite(plr_hwo, header, sizeof(WAVEHDR));
-            plr_buffers[i] = header;
-            queued = 1;
+            os_add(&plr_seq, 1);
+            plr_loop_end = plr_pos;
+            os_add(&plr_seq, 1);
+            continue;
         }
+
+        if (bytes == 0)
+        {
+            /* queue the tail of the track first */
+            if (pos > 0)
+                break;
+
+            plr_discard(buf);
+
+            /* the next track goes on the device right behind this one */
+            if (plr_next_ready)
+                return 0;
+
+            /* drained, the range is over */
+            if (sink_queued() == 0)
+                return 0;
+
+            /* woken early by a finished buffer or plr_cancel() */
+            sink_wait(100);
+
+            return 1;
+        }
+
+        pos += bytes;
+        plr_pos += bytes / frame;
     }
 
-    if (!queued)
+    int samples = pos / frame;
+
+    /* a 5.1 file downmixed, a mono one doubled */
+    if (plr_out_channels != plr_channels)
     {
-        free(header);
-        free(buf);
+        int frames = pos / frame;
+        char *out = malloc(frames * plr_out_channels * 2);
+
+        if (out)
+            layout_convert(&plr_conv, (short *)buf, (short *)out, frames);
+
+        plr_discard(buf);
+
+        if (!out)
+            return 0;
+
+        buf = out;
+        pos = frames * plr_out_channels * 2;
+    }
+
+    /* the track gain is part of the one multiply */
+    plr_gain((short *)buf, pos / 2, plr_vol / 100.0f * (plr_norm ? plr_track_gain : 1.0f));
+
+    stat_record(HIST_DECODE_US, stat_us(stat_ticks() - t0));
+
+    int in_queue = sink_queued();
+
+    if (plr_cnt > 0 && in_queue == 0)
+    {
+        /* the device ran dry while we were decoding */
+        stat_inc(STAT_UNDERRUNS);
+        plr_underruns++;
+        plr_clean_ms = 0;
+        if (plr_depth < plr_max_buffers)
+            plr_depth++;
+    }
+    else if ((plr_clean_ms += plr_block_ms) >= PLR_SHRINK_MS)
+    {
+        plr_clean_ms = 0;
+        if (plr_depth > plr_min_buffers)
+            plr_depth--;
+    }
+
+    /* a full queue leaves the time to open the next track */
+    if (plr_next_pending && in_queue >= plr_depth)
+        plr_load_next();
+
+    /* wait for the device to give back a buffer */
+    t0 = stat_ticks();
+
+    while (in_queue >= plr_depth && !plr_abort)
+    {
+        sink_wait(-1);
+        in_queue = sink_queued();
+    }
+
+    stat_record(HIST_WAIT_US, stat_us(stat_ticks() - t0));
+
+    if (plr_abort)
+    {
+        plr_discard(buf);
+        return 1;
     }
 
+    stat_inc(STAT_PUMPS);
+    stat_record(HIST_QUEUE_DEPTH, in_queue);
+
+    os_add(&plr_seq, 1);
+
+    sink_write(buf, pos);
+
+    plr_written = (int32_t)plr_pos;
+    plr_last = samples;
     plr_cnt++;
 
+    os_add(&plr_seq, 1);
+
     return 1;
 }
 
+/* Sample the listener hears now, from the start of the track, and the
+ * number of the plr_play() range it is in. That is the range before the
+ * last one while its end is still queued. The block playing is taken as
+ * just started. May be called from any thread. */
+int64_t plr_tell(int *range)
+{
+    int32_t seq;
+    int64_t pos;
+
+    do
+    {
+        while ((seq = os_load(&plr_seq)) & 1)
+            os_sleep(0);
+
+        int block = plr_rate * plr_block_ms / 1000;
+        int queued = sink_queued();
+
+        /* the blocks of this range are queued behind the tail */
+        int tail = queued - plr_cnt < plr_tail ? queued - plr_cnt : plr_tail;
+
+        *range = plr_ranges;
+
+        if (tail > 0)
+        {
+            pos = plr_tail_end - plr_tail_last - (int64_t)(tail - 1) * block;
+            pos = pos > plr_tail_from ? pos : plr_tail_from;
+            *range -= 1;
+            continue;
+        }
+
+        pos = plr_written - (queued > 0 ? plr_last + (int64_t)(queued - 1) * block : 0);
+
+        /* the queue may still hold the end of the loop after a wrap */
+        if (plr_loops && plr_loop_end >= 0 && pos < plr_loop_start)
+            pos += plr_loop_end - plr_loop_start;
+
+        pos = pos > plr_from ? pos : plr_from;
+    }
+    while (seq != os_load(&plr_seq));
+
+    return pos;
+}
+
 /* TODO: */
 /*
 int plr_seek(int sec)
 {
-    int len = (int)ov_time_total(&plr_vf, -1);
+    int len = (int)ov_time_total(plr_vf, -1);
     if(sec<0) sec=0;
     if(sec > len) sec = len;
-    return ov_time_seek(&plr_vf, (double)sec);
+    return ov_time_seek(plr_vf, (double)sec);
 }
 
 int plr_tell()
 {
-    int tpos = (int)ov_time_tell(&plr_vf);
+    int tpos = (int)ov_time_tell(plr_vf);
     return tpos;
 }
 */
@@ -1,5 +1,35 @@
+#include <stdint.h>
+
+#define PLR_MAX_BUFFERS 32
+
+/* LatencyProfile, the list ends with a NULL name */
+struct plr_profile
+{
+    const char *name;
+    int block_ms;
+    int min_buffers;
+    int max_buffers;
+};
+
+extern const struct plr_profile plr_profiles[];
+
+void plr_init();
 void plr_stop();
+void plr_pause();
+void plr_resume();
+void plr_cancel();
 void plr_volume(int vol);
+void plr_output_channels(int channels);
+void plr_normalize(int on);
+void plr_gain(short *buf, int samples, float scale);
+void plr_buffering(int block_ms, int min_buffers, int max_buffers);
+void plr_stats(int *latency_ms, int *underruns);
 int plr_pump();
-int plr_length(const char *path);
-int plr_play(const char *path);
+int64_t plr_length(const char *path, int *rate);
+int32_t plr_measure(const char *path);
+int plr_play(const char *path, int64_t from, int64_t to);
+void plr_preload(const char *path);
+int64_t plr_tell(int *range);
+int plr_range();
+void plr_loop(int64_t start, int64_t end);
+int plr_loop_tags(int64_t *start, int64_t *length);
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "catalog.h"
+#include "os.h"
+#include "playlist.h"
+
+/* The whole order of a play range is decided when it starts, so the player
+ * knows the next track while the current one plays and can open it ahead.
+ * The track the game asked to start at always comes first. Sequential
+ * plays the rest in track order, data tracks included like on a CD.
+ * Shuffle plays every other audio track of the range once. Weighted picks
+ * as many tracks as the range has audio tracks, each at random with the
+ * odds of its file name's weight, but never the same one twice in a row.
+ *
+ * Configured once at startup, used by the player thread only. */
+
+#define PLAYLIST_MAX        256     /* catalog slots */
+#define PLAYLIST_WEIGHTS    100
+
+static int order = PLAYLIST_SEQUENTIAL;
+static struct { char name[64]; int weight; } weights[PLAYLIST_WEIGHTS];
+static int num_weights = 0;
+
+static int list[PLAYLIST_MAX];
+static int count = 0;
+static int pos = 0;
+static uint32_t seed = 0;
+
+/* xorshift, the game's rand() is left alone */
+static uint32_t playlist_rand()
+{
+    if (!seed)
+        seed = (uint32_t)os_ticks() | 1;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+void playlist_order(int o)
+{
+    order = o < PLAYLIST_SEQUENTIAL || o > PLAYLIST_WEIGHTED ? PLAYLIST_SEQUENTIAL : o;
+}
+
+/* odds of the file name for weighted picks, 1 if not set, 0 never picks it */
+void playlist_weight(const char *name, int weight)
+{
+    if (num_weights == PLAYLIST_WEIGHTS || weight < 0)
+        return;
+
+    snprintf(weights[num_weights].name, sizeof weights[num_weights].name, "%s", name);
+    weights[num_weights++].weight = weight;
+}
+
+static int weight_of(const struct track_info *t)
+{
+    const char *name = t->path + strlen(t->path);
+    int i;
+
+    while (name > t->path && name[-1] != '\\' && name[-1] != '/')
+        name--;
+
+    for (i = 0; i < num_weights; i++)
+    {
+        if (!strcasecmp(name, weights[i].name))
+            return weights[i].weight;
+    }
+
+    return 1;
+}
+
+/* Lays out tracks first to last of cat, in track order when sequential is
+ * set whatever the configured order. */
+void playlist_start(const struct catalog *cat, int first, int last, int sequential)
+{
+    int tracks[PLAYLIST_MAX], odds[PLAYLIST_MAX];
+    int o = sequential ? PLAYLIST_SEQUENTIAL : order;
+    int n = 0, total = 0, i;
+
+    if (last >= cat->slots)
+        last = cat->slots - 1;
+
+    count = pos = 0;
+    list[count++] = first;
+
+    for (i = first + 1; i <= last; i++)
+    {
+        if (o == PLAYLIST_SEQUENTIAL)
+            list[count++] = i;
+        else if (cat->tracks[i].path[0])
+            tracks[n++] = i;
+    }
+
+    if (o == PLAYLIST_SHUFFLE)
+    {
+        /* Fisher-Yates */
+        for (i = n - 1; i > 0; i--)
+        {
+            int j = playlist_rand() % (i + 1), t = tracks[i];
+
+            tracks[i] = tracks[j];
+            tracks[j] = t;
+        }
+
+        memcpy(list + count, tracks, n * sizeof *tracks);
+        count += n;
+    }
+    else if (o == PLAYLIST_WEIGHTED && n > 0)
+    {
+        /* the first track is in the draw too */
+        if (first < cat->slots && cat->tracks[first].path[0])
+            tracks[n++] = first;
+
+        for (i = 0; i < n; i++)
+            total += odds[i] = weight_of(&cat->tracks[tracks[i]]);
+
+        while (count < n)
+        {
+            int prev = list[count - 1], sum = total, r, j;
+
+            for (j = 0; j < n; j++)
+            {
+                if (tracks[j] == prev)
+                    sum -= odds[j];
+            }
+
+            if (sum <= 0)
+                break;
+
+            r = playlist_rand() % sum;
+
+            for (j = 0; tracks[j] == prev || r >= odds[j]; j++)
+            {
+                if (tracks[j] != prev)
+                    r -= odds[j];
+            }
+
+            list[count++] = tracks[j];
+        }
+    }
+}
+
+/* the track to play next, 0 once the range is done */
+int playlist_next()
+{
+    return pos < count ? list[pos++] : 0;
+}
+
+/* the one after that, without moving on */
+int playlist_peek()
+{
+    return pos < count ? list[pos] : 0;
+}
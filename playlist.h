@@ -0,0 +1,17 @@
+/* The order the player goes through a range of tracks, see playlist.c */
+
+struct catalog;
+
+/* PlaylistOrder */
+enum
+{
+    PLAYLIST_SEQUENTIAL,    /* like a CD */
+    PLAYLIST_SHUFFLE,       /* every track once, in random order */
+    PLAYLIST_WEIGHTED       /* random picks by weight */
+};
+
+void playlist_order(int order);
+void playlist_weight(const char *name, int weight);
+void playlist_start(const struct catalog *cat, int first, int last, int sequential);
+int playlist_next();
+int playlist_peek();
@@ -0,0 +1,92 @@
+#include <string.h>
+#include "seek.h"
+
+/* Seek tables map sample positions to Ogg pages. Entry k is the last page
+ * of the stream that ends at or before sample k * interval; decoding from
+ * its start, vorbisfile loses the page's first packet to the overlap and
+ * still begins before that sample. So a seek is one jump in the file and
+ * less than one interval of decoding, instead of libvorbisfile's bisection
+ * which reads a page per step. */
+
+#define OGG_HEADER 27
+
+static uint64_t get_le(const unsigned char *p, int bytes)
+{
+    uint64_t v = 0;
+
+    while (bytes--)
+        v = v << 8 | p[bytes];
+
+    return v;
+}
+
+/* Fills samples / interval + 1 points from the page headers of the first
+ * logical stream in ogg. Returns the number of points, 0 if ogg is not an
+ * Ogg stream. */
+int seek_build(const unsigned char *ogg, size_t size, int64_t samples, uint32_t interval, struct seek_point *points)
+{
+    int count = interval && samples > 0 ? (int)(samples / interval) + 1 : 0;
+    uint32_t serial = 0;
+    size_t pos = 0;
+    int k = 0;
+
+    if (!count)
+        return 0;
+
+    /* the start of the stream is always a place to decode from */
+    points[0].granule = 0;
+    points[0].offset = 0;
+
+    while (pos + OGG_HEADER <= size)
+    {
+        const unsigned char *page = ogg + pos;
+        int64_t granule = (int64_t)get_le(page + 6, 8);
+        size_t len = OGG_HEADER + page[26];
+        int i;
+
+        if (memcmp(page, "OggS", 4) || page[4] != 0 || pos + len > size)
+            break;
+
+        for (i = 0; i < page[26]; i++)
+            len += page[OGG_HEADER + i];
+
+        if (pos == 0)
+            serial = (uint32_t)get_le(page + 14, 4);
+
+        /* pages that end no packet have granule -1 */
+        if (granule >= 0 && get_le(page + 14, 4) == serial)
+        {
+            /* points this page is too far for keep the page before */
+            while (k + 1 < count && granule > (int64_t)k * interval)
+            {
+                k++;
+                points[k] = points[k - 1];
+            }
+
+            if (granule > (int64_t)k * interval)
+                break;
+
+            points[k].granule = granule;
+            points[k].offset = pos;
+        }
+
+        pos += len;
+    }
+
+    if (pos == 0)
+        return 0;
+
+    /* a stream shorter than its length says */
+    while (++k < count)
+        points[k] = points[k - 1];
+
+    return count;
+}
+
+/* the point to decode from for sample, NULL past the end of the table */
+const struct seek_point *seek_find(const struct seek_point *points, uint32_t count, uint32_t interval, int64_t sample)
+{
+    int64_t k = interval && sample >= 0 ? sample / interval : count;
+
+    return k < count ? &points[k] : NULL;
+}
@@ -0,0 +1,14 @@
+/* Seek tables for Ogg streams, see seek.c */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* a page to start decoding from for samples at or after granule */
+struct seek_point
+{
+    int64_t granule;
+    uint64_t offset;        /* from the start of the stream */
+};
+
+int seek_build(const unsigned char *ogg, size_t size, int64_t samples, uint32_t interval, struct seek_point *points);
+const struct seek_point *seek_find(const struct seek_point *points, uint32_t count, uint32_t interval, int64_t sample);
@@ -0,0 +1,24 @@
+/* Audio output the player queues decoded blocks on. sink_waveout.c is the
+ * DLL's, sink_sim.c plays into nothing for the native tools. Blocks are
+ * 16-bit PCM at the rate and channel count given to sink_open(). */
+
+#include <stdint.h>
+
+void sink_init();
+int sink_open(int rate, int channels);
+void sink_close();                      /* drops and frees whatever is queued */
+void sink_write(void *data, int bytes); /* takes a malloc'd block, freed once played */
+int sink_queued();                      /* blocks not played yet */
+void sink_wait(int ms);                 /* until a block was played, sink_wake() or ms pass */
+void sink_wake();
+void sink_pause();
+void sink_resume();
+
+/* sink_sim.c only: playback speed, 1.0 is real time */
+extern double sink_sim_speed;
+
+/* sink_sim.c only: a clock that moves in sink_sim_run() instead, in
+ * microseconds from sink_sim_virtual() */
+void sink_sim_virtual();
+int sink_sim_settled(int ms);           /* a thread waits for the clock to move */
+void sink_sim_run(uint64_t us, void (*settle)());
@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include "os.h"
+#include "sink.h"
+
+/* Plays into nothing. A block counts as played once a clock, which runs at
+ * sink_sim_speed and stops while paused or starved, passes its end, so no
+ * thread is needed and the player sees the same queue behaviour as with a
+ * device.
+ *
+ * After sink_sim_virtual() the clock only moves in sink_sim_run(), one
+ * block end at a time, and each step waits for the player to be back in
+ * sink_wait(). What the player queued then depends on nothing but the
+ * clock, so a replay gives the same answers on every run. */
+
+#define SIM_MAX_BLOCKS 64
+
+struct sim_block
+{
+    void        *data;
+    uint64_t    end_us;         /* on the playback clock */
+};
+
+double                  sink_sim_speed  = 1.0;
+
+static struct sim_block sim_blocks[SIM_MAX_BLOCKS];
+static int              sim_head        = 0;
+static int              sim_count       = 0;
+static int              sim_frame       = 4;
+static int              sim_rate        = 44100;
+static int              sim_paused      = 0;
+static uint64_t         sim_clock_us    = 0;    /* audio played so far */
+static uint64_t         sim_clock_at    = 0;    /* sim_now() of the last advance */
+static uint64_t         sim_queued_us   = 0;    /* end of the last block */
+static os_mutex         sim_lock;
+static os_event         sim_ev;
+
+static int              sim_virtual     = 0;
+static uint64_t         sim_virtual_us  = 0;    /* now, on the virtual clock */
+static uint32_t         sim_step        = 0;    /* virtual clock moves so far */
+static uint32_t         sim_wait_step   = 0;    /* the step a waiter blocked at */
+static int              sim_waiting     = 0;
+static os_event         sim_settle_ev;          /* a waiter blocked */
+
+void sink_init()
+{
+    sim_lock      = os_mutex_create();
+    sim_ev        = os_event_create(0);
+    sim_settle_ev = os_event_create(0);
+}
+
+/* os_ticks(), or microseconds on the virtual clock */
+static uint64_t sim_now()
+{
+    return sim_virtual ? sim_virtual_us : os_ticks();
+}
+
+/* moves the clock to now and drops the blocks it passed, called locked */
+static void sim_advance()
+{
+    uint64_t now = sim_now();
+
+    if (!sim_paused && sim_virtual)
+        sim_clock_us += now - sim_clock_at;
+    else if (!sim_paused)
+        sim_clock_us += (uint64_t)((now - sim_clock_at) * 1e6 * sink_sim_speed / os_ticks_per_sec());
+
+    sim_clock_at = now;
+
+    if (sim_clock_us > sim_queued_us)
+        sim_clock_us = sim_queued_us;
+
+    while (sim_count && sim_blocks[sim_head].end_us <= sim_clock_us)
+    {
+        free(sim_blocks[sim_head].data);
+        sim_head = (sim_head + 1) % SIM_MAX_BLOCKS;
+        sim_count--;
+    }
+}
+
+int sink_open(int rate, int channels)
+{
+    os_mutex_lock(sim_lock);
+
+    sim_rate      = rate;
+    sim_frame     = channels * 2;
+    sim_paused    = 0;
+    sim_clock_us  = sim_queued_us = 0;
+    sim_clock_at  = sim_now();
+
+    os_mutex_unlock(sim_lock);
+
+    os_event_set(sim_ev);
+    return 1;
+}
+
+void sink_close()
+{
+    os_mutex_lock(sim_lock);
+
+    while (sim_count)
+    {
+        free(sim_blocks[sim_head].data);
+        sim_head = (sim_head + 1) % SIM_MAX_BLOCKS;
+        sim_count--;
+    }
+
+    sim_clock_us = sim_queued_us = 0;
+
+    os_mutex_unlock(sim_lock);
+}
+
+void sink_write(void *data, int bytes)
+{
+    os_mutex_lock(sim_lock);
+
+    sim_advance();
+
+    if (sim_count == SIM_MAX_BLOCKS)
+    {
+        free(data);
+    }
+    else
+    {
+        sim_queued_us += (uint64_t)bytes / sim_frame * 1000000 / sim_rate;
+        sim_blocks[(sim_head + sim_count) % SIM_MAX_BLOCKS].data   = data;
+        sim_blocks[(sim_head + sim_count) % SIM_MAX_BLOCKS].end_us = sim_queued_us;
+        sim_count++;
+    }
+
+    os_mutex_unlock(sim_lock);
+}
+
+int sink_queued()
+{
+    int n;
+
+    os_mutex_lock(sim_lock);
+    sim_advance();
+    n = sim_count;
+    os_mutex_unlock(sim_lock);
+
+    return n;
+}
+
+/* sleeps until the head block ends, or ms if nothing would end */
+void sink_wait(int ms)
+{
+    int until = ms;
+
+    os_mutex_lock(sim_lock);
+    sim_advance();
+
+    if (sim_virtual)
+    {
+        /* nothing ends before sink_sim_run() moves the clock */
+        until = -1;
+        sim_waiting = 1;
+        sim_wait_step = sim_step;
+        os_event_set(sim_settle_ev);
+    }
+    else if (sim_count && !sim_paused)
+    {
+        int left = (int)((sim_blocks[sim_head].end_us - sim_clock_us) / sink_sim_speed / 1000) + 1;
+
+        if (ms < 0 || left < ms)
+            until = left;
+    }
+
+    os_mutex_unlock(sim_lock);
+
+    os_event_wait(sim_ev, until);
+
+    os_mutex_lock(sim_lock);
+    sim_waiting = 0;
+    os_mutex_unlock(sim_lock);
+}
+
+void sink_wake()
+{
+    os_event_set(sim_ev);
+}
+
+void sink_pause()
+{
+    os_mutex_lock(sim_lock);
+    sim_advance();
+    sim_paused = 1;
+    os_mutex_unlock(sim_lock);
+}
+
+void sink_resume()
+{
+    os_mutex_lock(sim_lock);
+    sim_advance();
+    sim_paused = 0;
+    os_mutex_unlock(sim_lock);
+
+    os_event_set(sim_ev);
+}
+
+void sink_sim_virtual()
+{
+    os_mutex_lock(sim_lock);
+    sim_virtual = 1;
+    sim_virtual_us = sim_clock_at = 0;
+    os_mutex_unlock(sim_lock);
+}
+
+/* 1 once a thread waits for the clock since it last moved, waits up to ms */
+int sink_sim_settled(int ms)
+{
+    int settled;
+
+    os_mutex_lock(sim_lock);
+    settled = sim_waiting && sim_wait_step == sim_step;
+    os_mutex_unlock(sim_lock);
+
+    if (settled || !os_event_wait(sim_settle_ev, ms))
+        return settled;
+
+    os_mutex_lock(sim_lock);
+    settled = sim_waiting && sim_wait_step == sim_step;
+    os_mutex_unlock(sim_lock);
+
+    return settled;
+}
+
+/* Moves the virtual clock to us, stopping at the end of every block on the
+ * way. settle() is called before each step and returns once the player
+ * waits for the clock or there is no player. */
+void sink_sim_run(uint64_t us, void (*settle)())
+{
+    while (1)
+    {
+        uint64_t next = us;
+
+        settle();
+
+        os_mutex_lock(sim_lock);
+        sim_advance();
+
+        if (sim_virtual_us >= us)
+        {
+            os_mutex_unlock(sim_lock);
+            break;
+        }
+
+        if (sim_count && !sim_paused && sim_virtual_us + (sim_blocks[sim_head].end_us - sim_clock_us) < us)
+            next = sim_virtual_us + (sim_blocks[sim_head].end_us - sim_clock_us);
+
+        sim_virtual_us = next;
+        sim_advance();
+        sim_step++;
+
+        os_mutex_unlock(sim_lock);
+
+        os_event_set(sim_ev);
+    }
+}
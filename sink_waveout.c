@@ -0,0 +1,165 @@
+#include <windows.h>
+#include <stdlib.h>
+#include "player.h"
+#include "mixer.h"
+#include "sink.h"
+
+/* One waveOut device per track, opened through the DLL's own waveOut exports
+ * so the music joins the software mixer when it is enabled. */
+
+static HWAVEOUT         sink_hwo    = NULL;
+static HANDLE           sink_ev     = NULL;
+static WAVEHDR          *sink_blocks[PLR_MAX_BUFFERS];
+static CRITICAL_SECTION sink_cs;    /* guards all of the above, plr_tell() reaps from the game thread */
+
+void sink_init()
+{
+    InitializeCriticalSection(&sink_cs);
+}
+
+/* unprepares finished blocks, returns how many are still on the device;
+ * called with sink_cs held */
+static int sink_reap()
+{
+    int i, in_queue = 0;
+
+    for (i = 0; i < PLR_MAX_BUFFERS; i++)
+    {
+        if (sink_blocks[i] && sink_blocks[i]->dwFlags & WHDR_DONE)
+        {
+            fake_waveOutUnprepareHeader(sink_hwo, sink_blocks[i], sizeof(WAVEHDR));
+            free(sink_blocks[i]->lpData);
+            free(sink_blocks[i]);
+            sink_blocks[i] = NULL;
+        }
+
+        if (sink_blocks[i])
+            in_queue++;
+    }
+
+    return in_queue;
+}
+
+int sink_open(int rate, int channels)
+{
+    WAVEFORMATEX fmt;
+
+    fmt.wFormatTag      = WAVE_FORMAT_PCM;
+    fmt.nChannels       = channels;
+    fmt.nSamplesPerSec  = rate;
+    fmt.wBitsPerSample  = 16;
+    fmt.nBlockAlign     = fmt.nChannels * (fmt.wBitsPerSample / 8);
+    fmt.nAvgBytesPerSec = fmt.nBlockAlign * fmt.nSamplesPerSec;
+    fmt.cbSize          = 0;
+
+    EnterCriticalSection(&sink_cs);
+
+    sink_ev = CreateEvent(NULL, 0, 1, NULL);
+
+    if (fake_waveOutOpen(&sink_hwo, WAVE_MAPPER, &fmt, (DWORD)(DWORD_PTR)sink_ev, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR)
+    {
+        sink_hwo = NULL;
+        LeaveCriticalSection(&sink_cs);
+        return 0;
+    }
+
+    LeaveCriticalSection(&sink_cs);
+
+    return 1;
+}
+
+void sink_close()
+{
+    EnterCriticalSection(&sink_cs);
+
+    if (sink_hwo)
+    {
+        fake_waveOutReset(sink_hwo);
+        sink_reap();
+        fake_waveOutClose(sink_hwo);
+        sink_hwo = NULL;
+    }
+
+    if (sink_ev)
+    {
+        CloseHandle(sink_ev);
+        sink_ev = NULL;
+    }
+
+    LeaveCriticalSection(&sink_cs);
+}
+
+void sink_write(void *data, int bytes)
+{
+    WAVEHDR *header = malloc(sizeof(WAVEHDR));
+    int i;
+
+    header->dwBufferLength   = bytes;
+    header->lpData           = data;
+    header->dwUser           = 0;
+    header->dwFlags          = 0;
+    header->dwLoops          = 0;
+    header->lpNext           = NULL;
+    header->reserved         = 0;
+
+    EnterCriticalSection(&sink_cs);
+
+    for (i = 0; i < PLR_MAX_BUFFERS; i++)
+    {
+        if (sink_blocks[i] == NULL)
+        {
+            fake_waveOutPrepareHeader(sink_hwo, header, sizeof(WAVEHDR));
+            fake_waveOutWrite(sink_hwo, header, sizeof(WAVEHDR));
+            sink_blocks[i] = header;
+            LeaveCriticalSection(&sink_cs);
+            return;
+        }
+    }
+
+    LeaveCriticalSection(&sink_cs);
+
+    /* the player never queues more than PLR_MAX_BUFFERS */
+    free(data);
+    free(header);
+}
+
+int sink_queued()
+{
+    int in_queue;
+
+    EnterCriticalSection(&sink_cs);
+    in_queue = sink_reap();
+    LeaveCriticalSection(&sink_cs);
+
+    return in_queue;
+}
+
+void sink_wait(int ms)
+{
+    WaitForSingleObject(sink_ev, ms < 0 ? INFINITE : (DWORD)ms);
+}
+
+void sink_wake()
+{
+    EnterCriticalSection(&sink_cs);
+    if (sink_ev)
+        SetEvent(sink_ev);
+    LeaveCriticalSection(&sink_cs);
+}
+
+/* the device keeps its queued blocks, resume continues from the exact sample */
+void sink_pause()
+{
+    EnterCriticalSection(&sink_cs);
+    if (sink_hwo)
+        fake_waveOutPause(sink_hwo);
+    LeaveCriticalSection(&sink_cs);
+}
+
+void sink_resume()
+{
+    EnterCriticalSection(&sink_cs);
+    if (sink_hwo)
+        fake_waveOutRestart(sink_hwo);
+    LeaveCriticalSection(&sink_cs);
+}
@@ -0,0 +1,130 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <stdio.h>
+#include "os.h"
+#include "stats.h"
+
+/* Everything here is a plain array of ints bumped with atomic adds, so
+ * recording never takes a lock and costs a few nanoseconds. Histograms use
+ * power of two buckets, fine enough to tell a 50 us decode from a 5 ms one. */
+
+static volatile int32_t stat_counters[STAT_COUNTERS];
+static struct stat_hist stat_hists[STAT_HISTOGRAMS];
+static uint64_t         stat_freq;
+static int              stat_on         = 1;
+
+static const char *stat_counter_names[STAT_COUNTERS] =
+{
+    "pumps", "underruns", "tracks", "mci strings", "mci commands"
+};
+
+static const char *stat_hist_names[STAT_HISTOGRAMS] =
+{
+    "decode us", "wait us", "queue depth", "open us", "mci string us", "mci command us",
+    "mix us"
+};
+
+void stat_init()
+{
+    stat_freq = os_ticks_per_sec();
+}
+
+/* Off, recording and stat_ticks() cost a branch; tools/bench compares the
+ * two for the overhead. */
+void stat_enable(int on)
+{
+    stat_on = on;
+}
+
+void stat_inc(int counter)
+{
+    if (stat_on)
+        os_add(&stat_counters[counter], 1);
+}
+
+void stat_record(int histogram, uint32_t value)
+{
+    if (stat_on)
+        stat_hist_record(&stat_hists[histogram], value);
+}
+
+void stat_hist_record(struct stat_hist *h, uint32_t value)
+{
+    int bucket = value ? 32 - __builtin_clz(value) : 0;
+    int32_t max;
+
+    if (bucket >= STAT_BUCKETS)
+        bucket = STAT_BUCKETS - 1;
+
+    os_add(&h->bucket[bucket], 1);
+    os_add(&h->count, 1);
+
+    if ((uint32_t)os_add(&h->sum_lo, (int32_t)value) + value < value)
+        os_add(&h->sum_hi, 1);
+
+    while ((max = h->max) < (int32_t)value)
+        os_cas(&h->max, max, (int32_t)value);
+}
+
+uint64_t stat_ticks()
+{
+    return stat_on ? os_ticks() : 0;
+}
+
+uint32_t stat_us(uint64_t ticks)
+{
+    return (uint32_t)(ticks * 1000000 / stat_freq);
+}
+
+uint32_t stat_ns(uint64_t ticks)
+{
+    return (uint32_t)(ticks * 1000000000 / stat_freq);
+}
+
+uint64_t stat_hist_sum(struct stat_hist *h)
+{
+    return ((uint64_t)(uint32_t)h->sum_hi << 32) | (uint32_t)h->sum_lo;
+}
+
+void stat_hist_print(FILE *fp, const char *name, struct stat_hist *h)
+{
+    int j;
+
+    fprintf(fp, "\n%s: count %ld, avg %lu, max %ld\n", name, (long)h->count,
+        h->count ? (unsigned long)(stat_hist_sum(h) / (uint32_t)h->count) : 0, (long)h->max);
+
+    for (j = 0; j < STAT_BUCKETS; j++)
+    {
+        if (h->bucket[j])
+            fprintf(fp, "  < %-10lu %ld\n", 1UL << j, (long)h->bucket[j]);
+    }
+}
+
+/* Readers race with writers, the numbers are a snapshot and may be off by
+ * the calls that were in flight. */
+void stat_dump(const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    int i;
+
+    if (!fp)
+        return;
+
+    fprintf(fp, "ogg-winmm counters\n");
+    for (i = 0; i < STAT_COUNTERS; i++)
+        fprintf(fp, "  %-16s %ld\n", stat_counter_names[i], (long)stat_counters[i]);
+
+    for (i = 0; i < STAT_HISTOGRAMS; i++)
+        stat_hist_print(fp, stat_hist_names[i], &stat_hists[i]);
+
+    fclose(fp);
+}
+
+#ifdef _WIN32
+/* exported so a debugger or helper tool can ask for a dump at any time */
+void WINAPI OggWinmmDumpStats()
+{
+    stat_dump("winmm-stats.log");
+}
+#endif
@@ -0,0 +1,49 @@
+/* Hot-path counters and latency histograms, see stats.c */
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum stat_counter
+{
+    STAT_PUMPS,             /* plr_pump() calls that queued a block */
+    STAT_UNDERRUNS,         /* device ran out of queued audio */
+    STAT_TRACKS,            /* tracks opened by the player thread */
+    STAT_MCI_STRINGS,       /* mciSendString calls */
+    STAT_MCI_COMMANDS,      /* mciSendCommand calls, including the ones mciSendString makes */
+    STAT_COUNTERS
+};
+
+enum stat_histogram
+{
+    HIST_DECODE_US,         /* decoding one block in plr_pump() */
+    HIST_WAIT_US,           /* blocked on plr_ev waiting for a free buffer */
+    HIST_QUEUE_DEPTH,       /* blocks on the device when a new one is queued */
+    HIST_OPEN_US,           /* plr_play() opening a track */
+    HIST_MCI_STRING_US,     /* one mciSendString call */
+    HIST_MCI_COMMAND_US,    /* one mciSendCommand call */
+    HIST_MIX_US,            /* mixing one output block in mixer.c */
+    STAT_HISTOGRAMS
+};
+
+#define STAT_BUCKETS 24     /* bucket n holds values in [2^(n-1), 2^n) */
+
+struct stat_hist
+{
+    volatile int32_t count;
+    volatile int32_t max;
+    volatile int32_t sum_lo;    /* sum is kept in two halves, 32 bits overflow */
+    volatile int32_t sum_hi;    /* after ~35 minutes of waiting in microseconds */
+    volatile int32_t bucket[STAT_BUCKETS];
+};
+
+void stat_init();
+void stat_enable(int on);
+void stat_inc(int counter);
+void stat_record(int histogram, uint32_t value);
+void stat_hist_record(struct stat_hist *h, uint32_t value);
+uint64_t stat_hist_sum(struct stat_hist *h);
+void stat_hist_print(FILE *fp, const char *name, struct stat_hist *h);
+uint64_t stat_ticks();
+uint32_t stat_us(uint64_t ticks);
+uint32_t stat_ns(uint64_t ticks);
+void stat_dump(const char *path);
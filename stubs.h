@@ -0,0 +1,27 @@
+/* Forwarding of the winmm exports ogg-winmm does not emulate to the system
+ * winmm.dll, see stubs.c. */
+
+void forward_profile_open();
+void forward_profile_dump(const char *path);
+
+MCIERROR WINAPI real_mciSendCommandW(MCIDEVICEID IDDevice, UINT uMsg, DWORD_PTR fdwCommand, DWORD_PTR dwParam);
+MCIERROR WINAPI real_mciSendStringW(LPCWSTR cmd, LPWSTR ret, UINT cchReturn, HWND hwndCallback);
+
+MMRESULT WINAPI real_waveOutOpen(LPHWAVEOUT phwo, UINT uDeviceID, LPCWAVEFORMATEX pwfx, DWORD dwCallback, DWORD dwInstance, DWORD fdwOpen);
+MMRESULT WINAPI real_waveOutClose(HWAVEOUT hwo);
+MMRESULT WINAPI real_waveOutPrepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh);
+MMRESULT WINAPI real_waveOutUnprepareHeader(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh);
+MMRESULT WINAPI real_waveOutWrite(HWAVEOUT hwo, LPWAVEHDR pwh, UINT cbwh);
+MMRESULT WINAPI real_waveOutPause(HWAVEOUT hwo);
+MMRESULT WINAPI real_waveOutRestart(HWAVEOUT hwo);
+MMRESULT WINAPI real_waveOutReset(HWAVEOUT hwo);
+MMRESULT WINAPI real_waveOutGetPosition(HWAVEOUT hwo, LPMMTIME pmmt, UINT cbmmt);
+MMRESULT WINAPI real_waveOutGetVolume(HWAVEOUT hwo, PDWORD pdwVolume);
+MMRESULT WINAPI real_waveOutSetVolume(HWAVEOUT hwo, DWORD dwVolume);
+MMRESULT WINAPI real_waveOutGetID(HWAVEOUT hwo, LPUINT puDeviceID);
+MMRESULT WINAPI real_waveOutMessage(HWAVEOUT hwo, UINT uMsg, DWORD dw1, DWORD dw2);
+MMRESULT WINAPI real_waveOutBreakLoop(HWAVEOUT hwo);
+MMRESULT WINAPI real_waveOutGetPitch(HWAVEOUT hwo, PDWORD pdwPitch);
+MMRESULT WINAPI real_waveOutSetPitch(HWAVEOUT hwo, DWORD dwPitch);
+MMRESULT WINAPI real_waveOutGetPlaybackRate(HWAVEOUT hwo, PDWORD pdwRate);
+MMRESULT WINAPI real_waveOutSetPlaybackRate(HWAVEOUT hwo, DWORD dwRate);
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../core.h"
+#include "../os.h"
+#include "sample.h"
+
+volatile LONG failures = 0;
+
+/* Makes the temporary folder dir, a mkdtemp() template, with tracks first
+ * to last as NN.ogg copies of sample. 0 if that fails. */
+int sample_folder(const char *sample, char *dir, int first, int last)
+{
+    char path[512], buf[4096];
+    int i;
+
+    if (!mkdtemp(dir))
+        return 0;
+
+    for (i = first; i <= last; i++)
+    {
+        FILE *in = fopen(sample, "rb"), *out;
+        size_t n;
+
+        snprintf(path, sizeof path, "%s/%02d.ogg", dir, i);
+        out = fopen(path, "wb");
+
+        if (!in || !out)
+        {
+            if (in) fclose(in);
+            if (out) fclose(out);
+            return 0;
+        }
+
+        while ((n = fread(buf, 1, sizeof buf, in)) > 0)
+            fwrite(buf, 1, n, out);
+
+        fclose(in);
+        fclose(out);
+    }
+
+    return 1;
+}
+
+void sample_remove(const char *dir, int first, int last)
+{
+    char path[512];
+    int i;
+
+    for (i = first; i <= last; i++)
+    {
+        snprintf(path, sizeof path, "%s/%02d.ogg", dir, i);
+        remove(path);
+    }
+
+    /* plr_play() leaves its volume file in the working directory */
+    snprintf(path, sizeof path, "%s/winmm.ini", dir);
+    remove(path);
+    rmdir(dir);
+}
+
+/* a host notify for tests that don't look at notifications */
+void sample_ignore_notify(HWND hwnd, WPARAM status)
+{
+}
+
+double sample_ms_since(uint64_t t0)
+{
+    return (double)(os_ticks() - t0) * 1000 / os_ticks_per_sec();
+}
+
+/* an MCI_STATUS item of the device, of track if it isn't 0 */
+DWORD sample_status(DWORD item, int track)
+{
+    MCI_STATUS_PARMS parms;
+
+    memset(&parms, 0, sizeof parms);
+    parms.dwItem = item;
+    parms.dwTrack = track;
+    core_command(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM | (track ? MCI_TRACK : 0), (DWORD_PTR)&parms);
+
+    return parms.dwReturn;
+}
@@ -0,0 +1,17 @@
+/* What the native tests that play share: track folders made of the sample
+ * and a few helpers around the core, see sample.c. check() needs stdio.h
+ * and os.h. */
+
+#include <stdint.h>
+#include "../mcidefs.h"
+
+/* counts and prints a failure, from any thread */
+extern volatile LONG failures;
+
+#define check(cond, ...) do { if (!(cond)) { os_add(&failures, 1); fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+int sample_folder(const char *sample, char *dir, int first, int last);
+void sample_remove(const char *dir, int first, int last);
+void sample_ignore_notify(HWND hwnd, WPARAM status);
+double sample_ms_since(uint64_t t0);
+DWORD sample_status(DWORD item, int track);
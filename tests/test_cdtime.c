@@ -0,0 +1,142 @@
+/*
+ * test_cdtime - the conversions of cdtime.h against reference math
+ *
+ * Walks every frame of the MSF range, 256 minutes, counting minutes,
+ * seconds and frames by hand, and checks each conversion against it:
+ *   - frames to MSF and back, and the MCI_MAKE_MSF packing
+ *   - frames to TMSF offsets and back, for every track number
+ *   - frames to milliseconds and back, and every millisecond to its frame
+ *   - frames to sample offsets and back at the usual rates and a few odd
+ *     ones, and the first sample of each frame being the frame's
+ * and then the ends of the ranges, where the 32 bit arguments overflow if
+ * the arithmetic is done in the wrong width.
+ *
+ * usage: test_cdtime
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "../cdtime.h"
+#include "../mcidefs.h"
+
+#define MSF_FRAMES  (256 * 60 * CD_FPS)     /* minutes wrap at 256 */
+
+static int failures = 0;
+
+/* one message per kind of failure, the rest only counted */
+#define check(cond, ...) do { if (!(cond)) { if (failures++ < 20) { fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } } while (0)
+
+static const int rates[] = { 8000, 11025, 16000, 22050, 32000, 37800, 44100, 48000, 88200, 96000, 192000, 22222, 44101, 75 };
+
+/* ceil(a / b) without the formula under test */
+static int64_t ceil_div(int64_t a, int64_t b)
+{
+    return a / b + (a % b != 0);
+}
+
+static void test_frames()
+{
+    uint32_t frame = 0, m, s, f;
+    uint32_t track;
+
+    for (m = 0; m < 256; m++)
+    {
+        for (s = 0; s < 60; s++)
+        {
+            for (f = 0; f < CD_FPS; f++, frame++)
+            {
+                uint32_t msf = MCI_MAKE_MSF(m, s, f);
+                uint32_t ms = cd_frames_to_ms(frame);
+                int i;
+
+                check(cd_frames_to_msf(frame) == msf, "frame %u is MSF %08X, not %02u:%02u:%02u", frame, cd_frames_to_msf(frame), m, s, f);
+                check(cd_msf_to_frames(msf) == frame, "MSF %02u:%02u:%02u is frame %u, not %u", m, s, f, cd_msf_to_frames(msf), frame);
+
+                /* the first millisecond of the frame: in it, and the one
+                 * before in the frame before */
+                check((uint64_t)ms * CD_FPS >= (uint64_t)frame * 1000 && (ms == 0 || (uint64_t)(ms - 1) * CD_FPS < (uint64_t)frame * 1000),
+                    "frame %u starts at %u ms", frame, ms);
+                check(cd_ms_to_frames(ms) == frame, "frame %u -> %u ms -> frame %u", frame, ms, cd_ms_to_frames(ms));
+
+                /* TMSF for every track is the same MSF behind the track */
+                if (m < 100)
+                {
+                    for (track = 1; track <= 99; track += frame % 7 ? 98 : 1)
+                    {
+                        uint32_t tmsf = cd_tmsf(track, frame);
+
+                        check(MCI_TMSF_TRACK(tmsf) == track && MCI_TMSF_MINUTE(tmsf) == m && MCI_TMSF_SECOND(tmsf) == s && MCI_TMSF_FRAME(tmsf) == f,
+                            "track %u frame %u is TMSF %08X", track, frame, tmsf);
+                        check(cd_tmsf_offset(tmsf) == frame, "TMSF %08X is frame %u, not %u", tmsf, cd_tmsf_offset(tmsf), frame);
+                    }
+                }
+
+                for (i = 0; i < sizeof rates / sizeof *rates; i++)
+                {
+                    int64_t sample = cd_frames_to_samples(frame, rates[i]);
+
+                    check(sample == ceil_div((int64_t)frame * rates[i], CD_FPS), "frame %u at %d Hz starts at sample %lld", frame, rates[i], (long long)sample);
+                    check(cd_samples_to_frames(sample, rates[i]) == frame, "frame %u at %d Hz -> sample %lld -> frame %u",
+                        frame, rates[i], (long long)sample, cd_samples_to_frames(sample, rates[i]));
+
+                    /* the sample before is in the frame before, every rate
+                     * has at least one sample a frame */
+                    if (frame)
+                        check(cd_samples_to_frames(sample - 1, rates[i]) == frame - 1, "sample %lld at %d Hz isn't in frame %u",
+                            (long long)sample - 1, rates[i], frame - 1);
+                }
+            }
+        }
+    }
+
+    /* past the range the minutes wrap, the rest stays */
+    check(cd_frames_to_msf(MSF_FRAMES) == MCI_MAKE_MSF(0, 0, 0), "MSF doesn't wrap at 256 minutes");
+    check(cd_frames_to_msf(MSF_FRAMES + 61 * CD_FPS + 3) == MCI_MAKE_MSF(1, 1, 3), "MSF doesn't wrap at 256 minutes");
+}
+
+/* every millisecond of the range to the frame it lies in */
+static void test_ms()
+{
+    uint32_t ms, frame = 0;
+
+    for (ms = 0; ms < (uint64_t)MSF_FRAMES * 1000 / CD_FPS; ms++)
+    {
+        /* the frame moves on once its 1000 / 75 ms are over */
+        if ((uint64_t)(frame + 1) * 1000 <= (uint64_t)ms * CD_FPS)
+            frame++;
+
+        check(cd_ms_to_frames(ms) == frame, "%u ms is frame %u, not %u", ms, cd_ms_to_frames(ms), frame);
+    }
+}
+
+/* the largest arguments, where 32 bit intermediates would overflow */
+static void test_limits()
+{
+    uint32_t frames = UINT32_MAX / 1000 * CD_FPS;   /* its ms still fit */
+    int i;
+
+    check(cd_ms_to_frames(UINT32_MAX) == (uint32_t)((uint64_t)UINT32_MAX * CD_FPS / 1000), "UINT32_MAX ms is frame %u", cd_ms_to_frames(UINT32_MAX));
+    check(cd_ms_to_frames(cd_frames_to_ms(frames)) == frames, "frame %u doesn't round trip through ms", frames);
+    check(cd_msf_to_frames(MCI_MAKE_MSF(255, 59, 74)) == MSF_FRAMES - 1, "the last MSF isn't the last frame");
+    check(cd_tmsf_offset(MCI_MAKE_TMSF(99, 99, 59, 74)) == 100 * 60 * CD_FPS - 1, "the last TMSF offset isn't the last frame");
+
+    for (i = 0; i < sizeof rates / sizeof *rates; i++)
+    {
+        uint32_t f = UINT32_MAX;
+        int64_t sample = cd_frames_to_samples(f, rates[i]);
+
+        check(sample == ceil_div((int64_t)f * rates[i], CD_FPS), "frame %u at %d Hz starts at sample %lld", f, rates[i], (long long)sample);
+        check(cd_samples_to_frames(sample, rates[i]) == f, "frame %u at %d Hz doesn't round trip through samples", f, rates[i]);
+    }
+}
+
+int main()
+{
+    test_frames();
+    test_ms();
+    test_limits();
+
+    printf("test_cdtime: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * test_cue - CUE sheet parsing of cue.c
+ *
+ * Writes each sheet of the table below to a temporary folder, reads it back
+ * with cue_read() and checks every track it gives: number, audio or data,
+ * the FILE it is in, relative to the sheet, and the INDEX 01 frame. The
+ * sheets cover quoted and bare FILE names, INDEX 00 pregaps, data tracks,
+ * CRLF line ends, a byte order mark, track numbers the catalog can't index
+ * and more tracks than fit.
+ *
+ * usage: test_cue
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../cdtime.h"
+#include "../mcidefs.h"
+#include "../cue.h"
+
+#define MAX_WANT 4
+
+static int failures = 0;
+
+#define check(cond, ...) do { if (!(cond)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+#define MSF(m, s, f) (((m) * 60 + (s)) * CD_FPS + (f))
+
+struct want
+{
+    int number;
+    int audio;
+    const char *file;       /* in the sheet's folder, NULL before any FILE */
+    uint32_t index;
+};
+
+static const struct
+{
+    const char *name;
+    const char *sheet;
+    int max;
+    int count;
+    struct want tracks[MAX_WANT];
+}
+cases[] =
+{
+    {
+        "quoted name, INDEX 00 pregap",
+        "FILE \"My Disc.ogg\" OGG\n"
+        "  TRACK 01 AUDIO\n"
+        "    INDEX 01 00:00:00\n"
+        "  TRACK 02 AUDIO\n"
+        "    INDEX 00 03:59:70\n"
+        "    INDEX 01 04:01:05\n",
+        CUE_MAX_TRACKS, 2,
+        { { 1, 1, "My Disc.ogg", 0 }, { 2, 1, "My Disc.ogg", MSF(4, 1, 5) } }
+    },
+    {
+        "bare name, data track first",
+        "FILE disc.ogg WAVE\n"
+        "TRACK 01 MODE1/2352\n"
+        "INDEX 01 00:00:00\n"
+        "TRACK 02 AUDIO\n"
+        "PREGAP 00:02:00\n"
+        "INDEX 01 12:34:56\n",
+        CUE_MAX_TRACKS, 2,
+        { { 1, 0, "disc.ogg", 0 }, { 2, 1, "disc.ogg", MSF(12, 34, 56) } }
+    },
+    {
+        "BOM, CRLF, tabs and lower case",
+        "\xEF\xBB\xBFREM GENRE Soundtrack\r\n"
+        "file\t\"a b.ogg\"\tOGG\r\n"
+        "\ttrack 03 audio\r\n"
+        "\t\tTITLE \"INDEX 01 09:09:09\"\r\n"
+        "\t\tindex 01 01:02:03\r\n",
+        CUE_MAX_TRACKS, 1,
+        { { 3, 1, "a b.ogg", MSF(1, 2, 3) } }
+    },
+    {
+        "two files",
+        "FILE \"one.ogg\" OGG\n"
+        "TRACK 01 AUDIO\n"
+        "INDEX 01 00:00:00\n"
+        "FILE \"two.ogg\" OGG\n"
+        "TRACK 02 AUDIO\n"
+        "INDEX 01 00:00:10\n",
+        CUE_MAX_TRACKS, 2,
+        { { 1, 1, "one.ogg", 0 }, { 2, 1, "two.ogg", 10 } }
+    },
+    {
+        "track numbers out of range, INDEX of a skipped track",
+        "FILE \"x.ogg\" OGG\n"
+        "TRACK 00 AUDIO\n"
+        "INDEX 01 00:01:00\n"
+        "TRACK 100 AUDIO\n"
+        "INDEX 01 00:02:00\n"
+        "TRACK 99 AUDIO\n"
+        "INDEX 01 00:03:00\n",
+        CUE_MAX_TRACKS, 1,
+        { { 99, 1, "x.ogg", MSF(0, 3, 0) } }
+    },
+    {
+        "track before any FILE",
+        "TRACK 01 AUDIO\n"
+        "INDEX 01 00:00:01\n",
+        CUE_MAX_TRACKS, 1,
+        { { 1, 1, NULL, 1 } }
+    },
+    {
+        "more tracks than fit",
+        "FILE \"x.ogg\" OGG\n"
+        "TRACK 01 AUDIO\n"
+        "INDEX 01 00:00:00\n"
+        "TRACK 02 AUDIO\n"
+        "INDEX 01 00:01:00\n"
+        "TRACK 03 AUDIO\n"
+        "INDEX 01 00:02:00\n",
+        2, 2,
+        { { 1, 1, "x.ogg", 0 }, { 2, 1, "x.ogg", MSF(0, 1, 0) } }
+    },
+    {
+        "no tracks",
+        "REM nothing\n"
+        "FILE \"x.ogg\" OGG\n",
+        CUE_MAX_TRACKS, 0,
+        { { 0 } }
+    },
+};
+
+static void test_case(const char *dir, int c)
+{
+    struct cue_track tracks[CUE_MAX_TRACKS];
+    char path[512], file[512];
+    FILE *fp;
+    int count, i;
+
+    snprintf(path, sizeof path, "%s/disc.cue", dir);
+    fp = fopen(path, "wb");
+
+    if (!fp)
+    {
+        check(0, "%s: can't write the sheet", cases[c].name);
+        return;
+    }
+
+    fputs(cases[c].sheet, fp);
+    fclose(fp);
+
+    memset(tracks, 0xAA, sizeof tracks);
+    count = cue_read(path, tracks, cases[c].max);
+
+    check(count == cases[c].count, "%s: %d tracks, not %d", cases[c].name, count, cases[c].count);
+
+    for (i = 0; i < count && i < cases[c].count; i++)
+    {
+        const struct want *w = &cases[c].tracks[i];
+        const struct cue_track *t = &tracks[i];
+
+        if (w->file)
+            snprintf(file, sizeof file, "%s/%s", dir, w->file);
+        else
+            file[0] = '\0';
+
+        check(t->number == w->number, "%s: track %d is number %d, not %d", cases[c].name, i, t->number, w->number);
+        check(t->audio == w->audio, "%s: track %d is %s", cases[c].name, w->number, t->audio ? "audio" : "data");
+        check(!strcmp(t->file, file), "%s: track %d is in \"%s\", not \"%s\"", cases[c].name, w->number, t->file, file);
+        check(t->index == w->index, "%s: track %d starts at frame %u, not %u", cases[c].name, w->number, t->index, w->index);
+    }
+
+    remove(path);
+}
+
+int main()
+{
+    char dir[] = "/tmp/oggcueXXXXXX", path[512];
+    struct cue_track track;
+    int i;
+
+    if (!mkdtemp(dir))
+    {
+        fprintf(stderr, "test_cue: can't make a temporary folder\n");
+        return 1;
+    }
+
+    for (i = 0; i < sizeof cases / sizeof *cases; i++)
+        test_case(dir, i);
+
+    snprintf(path, sizeof path, "%s/missing.cue", dir);
+    check(cue_read(path, &track, 1) == 0, "a missing sheet has tracks");
+
+    rmdir(dir);
+
+    printf("test_cue: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * test_latency - how fast the device reacts to the game
+ *
+ * Runs the core natively against the simulated sink in real time, with
+ * 20 ms blocks, and fails when
+ *   - resume takes longer than one block to get the device going again,
+ *     or the position moves while paused
+ *   - stop takes longer than STOP_MS, at random points of playback and
+ *     with a sink slowed down so far that the player always waits on it
+ *
+ * A run over its limit is repeated up to ATTEMPTS times and only fails if
+ * every attempt is, so a thread preempted on a loaded machine, which the
+ * sanitizers make more likely, doesn't fail the test but a slow path does.
+ *
+ * The sample has to play for a few seconds, 5 are enough.
+ *
+ * usage: test_latency sample.ogg
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../core.h"
+#include "../os.h"
+#include "../player.h"
+#include "../sink.h"
+#include "../stats.h"
+#include "sample.h"
+
+#define TRACK       2
+#define BLOCK_MS    20
+#define RUNS        50
+#define STOP_MS     10
+#define ATTEMPTS    5
+
+static void play_track()
+{
+    MCI_PLAY_PARMS parms;
+
+    memset(&parms, 0, sizeof parms);
+    parms.dwFrom = MCI_MAKE_TMSF(TRACK, 0, 0, 0);
+    core_command(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM, (DWORD_PTR)&parms);
+}
+
+/* Resume is the command returning with the sink running again; the queue
+ * was kept, so that is when the listener hears the music again. */
+static double resume_once()
+{
+    DWORD before, after;
+    uint64_t t0;
+    double ms;
+
+    core_command(MAGIC_DEVICEID, MCI_PAUSE, 0, 0);
+    before = sample_status(MCI_STATUS_POSITION, 0);
+    os_sleep(30);
+    after = sample_status(MCI_STATUS_POSITION, 0);
+
+    check(before == after, "position moved from %08X to %08X while paused", (unsigned)before, (unsigned)after);
+
+    t0 = os_ticks();
+    core_command(MAGIC_DEVICEID, MCI_RESUME, 0, 0);
+    ms = sample_ms_since(t0);
+
+    check(sample_status(MCI_STATUS_MODE, 0) == MCI_MODE_PLAY, "not playing after resume");
+    os_sleep(rand() % 20);
+
+    return ms;
+}
+
+/* stop is the command returning with the player thread gone */
+static double stop_once()
+{
+    uint64_t t0;
+    double ms;
+
+    play_track();
+    os_sleep(rand() % 50);
+
+    t0 = os_ticks();
+    core_command(MAGIC_DEVICEID, MCI_STOP, 0, 0);
+    ms = sample_ms_since(t0);
+
+    check(sink_queued() == 0, "audio still queued after stop");
+
+    return ms;
+}
+
+/* worst of RUNS runs, each the best of up to ATTEMPTS tries at the limit */
+static double worst_of(double (*run)(), double limit, int *retried)
+{
+    double worst = 0;
+    int i, a;
+
+    for (i = 0; i < RUNS; i++)
+    {
+        double best = run();
+
+        for (a = 1; a < ATTEMPTS && best > limit; a++)
+        {
+            double ms = run();
+
+            (*retried)++;
+            if (ms < best)
+                best = ms;
+        }
+
+        if (best > worst)
+            worst = best;
+    }
+
+    return worst;
+}
+
+static void test_resume()
+{
+    double worst;
+    int retried = 0;
+
+    play_track();
+    os_sleep(100);
+
+    worst = worst_of(resume_once, BLOCK_MS, &retried);
+
+    core_command(MAGIC_DEVICEID, MCI_STOP, 0, 0);
+
+    printf("resume: worst %.3f ms of %d ms allowed, %d runs repeated\n", worst, BLOCK_MS, retried);
+    check(worst <= BLOCK_MS, "resume took %.3f ms, more than one %d ms block", worst, BLOCK_MS);
+}
+
+static void test_stop()
+{
+    double worst, slow;
+    int retried = 0;
+
+    worst = worst_of(stop_once, STOP_MS, &retried);
+    sink_sim_speed = 0.05;
+    slow = worst_of(stop_once, STOP_MS, &retried);
+    sink_sim_speed = 1.0;
+
+    printf("stop: worst %.3f ms, %.3f ms with a slow sink, of %d ms allowed, %d runs repeated\n", worst, slow, STOP_MS, retried);
+    check(worst <= STOP_MS, "stop took %.3f ms, more than %d ms", worst, STOP_MS);
+    check(slow <= STOP_MS, "stop took %.3f ms with a slow sink, more than %d ms", slow, STOP_MS);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct core_host host = { core_command, sample_ignore_notify };
+    char dir[] = "/tmp/ogglatencyXXXXXX", cwd[1024], sample[1024];
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: test_latency sample.ogg\n");
+        return 1;
+    }
+
+    if (!getcwd(cwd, sizeof cwd) || !realpath(argv[1], sample) || !sample_folder(sample, dir, TRACK, TRACK) || chdir(dir) != 0)
+    {
+        fprintf(stderr, "%s: can't set up the track folder\n", argv[1]);
+        return 1;
+    }
+
+    alarm(120);
+
+    srand(1);
+    stat_init();
+    plr_init();
+    plr_buffering(BLOCK_MS, 4, 16);
+    core_init(&host);
+    core_scan(dir, 0);
+
+    core_command(MAGIC_DEVICEID, MCI_OPEN, 0, 0);
+
+    test_resume();
+    test_stop();
+
+    core_command(MAGIC_DEVICEID, MCI_CLOSE, 0, 0);
+
+    sample_remove(dir, TRACK, TRACK);
+
+    if (chdir(cwd) != 0)
+        return 1;
+
+    printf("test_latency: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * test_layout - channel layout conversion of layout.c
+ *
+ * For every input channel count and every output the player opens the
+ * device with, mono, stereo or the input's own, checks
+ *   - the selected kernel (SSE2 where the CPU has it) giving exactly what
+ *     layout_convert_scalar() gives, for every block length up to 40 and a
+ *     long one, on random samples with full scale ones mixed in; the
+ *     buffers are allocated to the exact size, so the sanitizer catches a
+ *     kernel that reads or writes past them
+ *   - the matrix: identity for the input's own layout, mono doubled at full
+ *     level, downmix rows summing to just under 1.0 so full scale input
+ *     can't clip, the LFE left out and mono as the mean of the stereo fold
+ *
+ * usage: test_layout
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../layout.h"
+
+#define C1          16384
+#define LONG_BLOCK  882     /* 20 ms at 44.1 kHz */
+
+static int failures = 0;
+
+/* one message per kind of failure, the rest only counted */
+#define check(cond, ...) do { if (!(cond)) { if (failures++ < 20) { fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } } while (0)
+
+/* the LFE channel of each count in Vorbis order, -1 without one */
+static const int lfe[LAYOUT_MAX_CHANNELS + 1] = { -1, -1, -1, -1, -1, -1, 5, 6, 7 };
+
+static int16_t sample()
+{
+    switch (rand() % 8)
+    {
+        case 0:  return 32767;
+        case 1:  return -32768;
+        default: return (int16_t)rand();
+    }
+}
+
+static void test_kernel(int in, int out)
+{
+    struct layout l;
+    int frames;
+
+    layout_matrix(&l, in, out);
+
+    for (frames = 0; frames <= 41; frames++)
+    {
+        int n = frames == 41 ? LONG_BLOCK : frames, i;
+        int16_t *src = malloc(n * in * sizeof *src + !n);
+        int16_t *want = malloc(n * out * sizeof *want + !n);
+        int16_t *got = malloc(n * out * sizeof *got + !n);
+
+        if (!src || !want || !got)
+            exit(1);
+
+        for (i = 0; i < n * in; i++)
+            src[i] = sample();
+
+        layout_convert_scalar(&l, src, want, n);
+        layout_convert(&l, src, got, n);
+
+        for (i = 0; i < n * out && got[i] == want[i]; i++)
+            ;
+
+        check(i == n * out, "%d to %d channels, %d frames: sample %d is %d, not %d", in, out, n, i, got[i], want[i]);
+
+        free(src);
+        free(want);
+        free(got);
+    }
+}
+
+static void test_matrix(int in)
+{
+    struct layout self, mono, stereo;
+    int o, i;
+
+    layout_matrix(&self, in, in);
+    layout_matrix(&mono, in, 1);
+    layout_matrix(&stereo, in, 2);
+
+    for (o = 0; o < in; o++)
+    {
+        for (i = 0; i < in; i++)
+            check(self.m[o][i] == (o == i ? C1 : 0), "%d channels to themselves isn't the identity", in);
+    }
+
+    if (in == 1)
+    {
+        check(stereo.m[0][0] == C1 && stereo.m[1][0] == C1, "mono isn't doubled at full level");
+        return;
+    }
+
+    for (o = 0; o < 2; o++)
+    {
+        int32_t sum = 0;
+
+        for (i = 0; i < in; i++)
+            sum += stereo.m[o][i];
+
+        check(sum <= C1 && sum >= C1 - in, "%d channels to stereo: row %d sums to %d", in, o, sum);
+    }
+
+    for (i = 0; i < in; i++)
+    {
+        check(mono.m[0][i] == (stereo.m[0][i] + stereo.m[1][i]) / 2, "%d channels to mono: channel %d isn't the mean of the stereo fold", in, i);
+
+        if (i == lfe[in])
+            check(!stereo.m[0][i] && !stereo.m[1][i] && !mono.m[0][i], "%d channels: the LFE is mixed in", in);
+    }
+}
+
+int main()
+{
+    int in;
+
+    srand(1);
+    layout_kernel_init();
+
+    for (in = 1; in <= LAYOUT_MAX_CHANNELS; in++)
+    {
+        test_kernel(in, in);
+        test_kernel(in, 1);
+
+        if (in != 2)
+            test_kernel(in, 2);
+
+        test_matrix(in);
+    }
+
+    printf("test_layout: %s, %s kernel\n", failures ? "FAILED" : "ok", layout_convert == layout_convert_scalar ? "scalar" : "SSE2");
+    return failures != 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * test_loudness - track gains of loudness.c
+ *
+ * Feeds the tones of the table below to the analysis, in odd sized chunks,
+ * and checks the gain loud_gain() gives against the EBU R128 figures: a
+ * 1 kHz tone at -23 dBFS on both stereo channels is -23 LUFS, so 5 dB under
+ * the -18 LUFS target. The cases cover both gates, mono, the 5.1 channel
+ * weights, the clip limit and input the analysis has to ignore. R128
+ * meters may be 0.1 LU off, which is the tolerance unless a case has its
+ * own.
+ *
+ * usage: test_loudness
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "../loudness.h"
+
+#define MAX_PARTS   2
+#define CHUNK       4093
+
+static int failures = 0;
+
+#define check(cond, ...) do { if (!(cond)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+/* a 1 kHz tone at dbfs on the channels in mask, or silence with mask 0 */
+struct part
+{
+    int ms;
+    double dbfs;
+    unsigned mask;
+};
+
+static const struct
+{
+    const char *name;
+    int rate;
+    int channels;
+    int32_t gain;           /* hundredths of a dB */
+    int tolerance;
+    int click;              /* one full scale sample at the start */
+    struct part parts[MAX_PARTS];
+}
+cases[] =
+{
+    { "stereo -23 dBFS at 48 kHz",          48000, 2, 500,  10, 0, { { 20000, -23, 3 } } },
+    { "stereo -20 dBFS at 44.1 kHz",        44100, 2, 200,  10, 0, { { 20000, -20, 3 } } },
+    { "mono -10 dBFS, 3 dB under stereo",   44100, 1, -500, 10, 0, { { 10000, -10, 1 } } },
+    { "absolute gate, half silence",        48000, 2, 500,  10, 0, { { 10000, -23, 3 }, { 10000, 0, 0 } } },
+    { "relative gate, half 30 dB quieter",  48000, 2, 500,  10, 0, { { 10000, -23, 3 }, { 10000, -53, 3 } } },
+    { "5.1 front left",                     48000, 6, 800,  10, 0, { { 10000, -23, 1 << 0 } } },
+    { "5.1 surround 1.5 dB louder",         48000, 6, 651,  10, 0, { { 10000, -23, 1 << 3 } } },
+    { "5.1 LFE not counted",                48000, 6, 0,    0,  0, { { 10000, -10, 1 << 5 } } },
+    { "limited by the peak",                44100, 2, 0,    0,  1, { { 10000, -50, 3 } } },
+    { "silence",                            44100, 2, 0,    0,  0, { { 10000, 0, 0 } } },
+    { "shorter than one block",             48000, 2, 0,    0,  0, { { 350, -23, 3 } } },
+    { "more channels than measured",        48000, 9, 0,    0,  0, { { 10000, -23, 1 } } },
+};
+
+static short *make_pcm(int c, int *frames)
+{
+    int rate = cases[c].rate, channels = cases[c].channels, total = 0, p, f, n = 0;
+    short *pcm;
+
+    for (p = 0; p < MAX_PARTS; p++)
+        total += (int)((int64_t)cases[c].parts[p].ms * rate / 1000);
+
+    pcm = calloc((size_t)total * channels, sizeof *pcm);
+
+    for (p = 0; p < MAX_PARTS && pcm; p++)
+    {
+        const struct part *part = &cases[c].parts[p];
+        int len = (int)((int64_t)part->ms * rate / 1000);
+        double amp = 32767 * pow(10, part->dbfs / 20);
+
+        for (f = 0; f < len; f++, n++)
+        {
+            short s = (short)lrint(amp * sin(2 * M_PI * 1000 * n / rate));
+            int ch;
+
+            for (ch = 0; ch < channels; ch++)
+                pcm[n * channels + ch] = part->mask & (1u << ch) ? s : 0;
+        }
+    }
+
+    if (pcm && cases[c].click)
+        pcm[0] = 32767;
+
+    *frames = total;
+    return pcm;
+}
+
+int main()
+{
+    struct loudness *l = malloc(sizeof *l);
+    int c;
+
+    for (c = 0; c < sizeof cases / sizeof *cases && l; c++)
+    {
+        int frames, f, n;
+        short *pcm = make_pcm(c, &frames);
+        int32_t gain;
+
+        if (!pcm)
+            break;
+
+        loud_init(l, cases[c].rate, cases[c].channels);
+
+        for (f = 0; f < frames; f += n)
+        {
+            n = frames - f < CHUNK ? frames - f : CHUNK;
+            loud_add(l, pcm + (size_t)f * cases[c].channels, n);
+        }
+
+        gain = loud_gain(l);
+        check(abs(gain - cases[c].gain) <= cases[c].tolerance, "%s: gain %d, not %d", cases[c].name, gain, cases[c].gain);
+
+        free(pcm);
+    }
+
+    free(l);
+
+    printf("test_loudness: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
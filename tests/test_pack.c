@@ -0,0 +1,218 @@
+/*
+ * test_pack - music.pak index checks of pack.c
+ *
+ * Writes a small archive by hand, two tracks with seek tables, and checks
+ * that pack_open() takes it and pack_find() and pack_at() find its
+ * streams. Then every field of the index that points into the file is
+ * corrupted in turn, as in the table below, and the archive cut short at
+ * every length; pack_open() must reject each of them instead of handing
+ * the player offsets past the mapping.
+ *
+ * usage: test_pack
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../pack.h"
+#include "../seek.h"
+
+static int failures = 0;
+
+#define check(cond, ...) do { if (!(cond)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+/* pack.c measures tracks through the player, which is not needed here */
+int64_t plr_length(const char *path, int *rate)
+{
+    *rate = 0;
+    return 0;
+}
+
+int32_t plr_measure(const char *path)
+{
+    return 0;
+}
+
+/* two streams with 2 and 3 seek points, the second table ends the file */
+static const char stream1[] = "OggS stream one, not a real one";
+static const char stream2[] = "OggS two";
+
+struct archive
+{
+    struct pack_header h;
+    struct pack_entry e[2];
+    unsigned char data[512];
+};
+
+enum { ABS, REL_SIZE, REL_FIELD };
+
+static const struct
+{
+    const char *name;
+    int entry;              /* -1 for the header */
+    size_t field;
+    int bytes;
+    int rel;                /* the value is absolute, or added to the file size or the field */
+    int64_t value;
+}
+corrupt[] =
+{
+    { "bad magic",                  -1, offsetof(struct pack_header, magic),       1, ABS,       'X' },
+    { "count past the file",        -1, offsetof(struct pack_header, count),       4, REL_SIZE,  0 },
+    { "count near 2^32",            -1, offsetof(struct pack_header, count),       4, ABS,       0xFFFFFFFF },
+    { "offset past the end",        0,  offsetof(struct pack_entry, offset),       8, REL_SIZE,  1 },
+    { "offset wrapping",            1,  offsetof(struct pack_entry, offset),       8, ABS,       -8 },
+    { "size past the end",          1,  offsetof(struct pack_entry, size),         8, REL_SIZE,  0 },
+    { "size wrapping",              0,  offsetof(struct pack_entry, size),         8, ABS,       -1 },
+    { "misaligned seek table",      0,  offsetof(struct pack_entry, seek_offset),  8, REL_FIELD, 4 },
+    { "seek table past the end",    0,  offsetof(struct pack_entry, seek_offset),  8, REL_SIZE,  8 },
+    { "seek table too long",        1,  offsetof(struct pack_entry, seek_count),   4, REL_FIELD, 1 },
+    { "seek count near 2^32",       0,  offsetof(struct pack_entry, seek_count),   4, ABS,       0xFFFFFFFF },
+};
+
+/* lays out the archive, returns its size */
+static size_t build(struct archive *a)
+{
+    size_t base = offsetof(struct archive, data), pos = 0;
+    struct seek_point *p;
+
+    memset(a, 0, sizeof *a);
+    memcpy(a->h.magic, PACK_MAGIC, sizeof a->h.magic);
+    a->h.count = 2;
+
+    a->e[0].track = 2;
+    a->e[0].offset = base + pos;
+    a->e[0].size = sizeof stream1;
+    memcpy(a->data + pos, stream1, sizeof stream1);
+    pos = (pos + sizeof stream1 + 7) & ~(size_t)7;
+    a->e[0].seek_offset = base + pos;
+    a->e[0].seek_count = 2;
+    a->e[0].seek_interval = 1000;
+    p = (struct seek_point *)(a->data + pos);
+    p[1].granule = 900;
+    pos += 2 * sizeof *p;
+
+    a->e[1].track = 5;
+    a->e[1].offset = base + pos;
+    a->e[1].size = sizeof stream2;
+    memcpy(a->data + pos, stream2, sizeof stream2);
+    pos = (pos + sizeof stream2 + 7) & ~(size_t)7;
+    a->e[1].seek_offset = base + pos;
+    a->e[1].seek_count = 3;
+    pos += 3 * sizeof(struct seek_point);
+
+    return base + pos;
+}
+
+static int save(const char *path, const void *data, size_t size)
+{
+    FILE *fp = fopen(path, "wb");
+    int ok;
+
+    if (!fp)
+        return 0;
+
+    ok = fwrite(data, 1, size, fp) == size;
+    return (fclose(fp) == 0) & ok;
+}
+
+static void test_valid(const char *path)
+{
+    struct archive a;
+    size_t size = build(&a);
+    const struct pack_entry *e;
+    char track[600];
+
+    if (!save(path, &a, size))
+    {
+        check(0, "can't write %s", path);
+        return;
+    }
+
+    check(pack_open(path), "a valid archive is rejected");
+    check(pack_index(&e) == 2, "the index has %d entries", pack_index(&e));
+
+    snprintf(track, sizeof track, "%s#05", path);
+    e = pack_find(track);
+    check(e && e->track == 5 && !memcmp(pack_at(e->offset), stream2, sizeof stream2), "track 5 isn't found");
+
+    snprintf(track, sizeof track, "%s#02", path);
+    e = pack_find(track);
+    check(e && !memcmp(pack_at(e->offset), stream1, sizeof stream1), "track 2 isn't found");
+    check(e && ((const struct seek_point *)pack_at(e->seek_offset))[1].granule == 900, "the seek table of track 2 isn't found");
+
+    snprintf(track, sizeof track, "%s#03", path);
+    check(!pack_find(track), "track 3 is found");
+    check(!pack_find("elsewhere#02"), "a track of another archive is found");
+
+    /* one archive at a time */
+    check(pack_open(path), "opening the mapped archive again fails");
+    check(!pack_open("elsewhere"), "a second archive opens");
+
+    pack_close();
+}
+
+static void test_corrupt(const char *path)
+{
+    struct archive a;
+    size_t size = build(&a);
+    int i;
+
+    for (i = 0; i < sizeof corrupt / sizeof *corrupt; i++)
+    {
+        unsigned char *field;
+        uint64_t v = 0;
+
+        build(&a);
+        field = (corrupt[i].entry < 0 ? (unsigned char *)&a.h : (unsigned char *)&a.e[corrupt[i].entry]) + corrupt[i].field;
+
+        if (corrupt[i].rel == REL_FIELD)
+            memcpy(&v, field, corrupt[i].bytes);
+
+        v += corrupt[i].value + (corrupt[i].rel == REL_SIZE ? size : 0);
+        memcpy(field, &v, corrupt[i].bytes);
+
+        if (!save(path, &a, size))
+            continue;
+
+        check(!pack_open(path), "an archive with %s is taken", corrupt[i].name);
+        pack_close();
+    }
+
+    build(&a);
+
+    for (i = 0; i < size; i++)
+    {
+        if (!save(path, &a, i))
+            continue;
+
+        check(!pack_open(path), "an archive cut to %d of %d bytes is taken", i, (int)size);
+        pack_close();
+    }
+}
+
+int main()
+{
+    char dir[] = "/tmp/oggpakXXXXXX", path[512];
+
+    if (!mkdtemp(dir))
+    {
+        fprintf(stderr, "test_pack: can't make a temporary folder\n");
+        return 1;
+    }
+
+    snprintf(path, sizeof path, "%s/" PACK_NAME, dir);
+
+    test_valid(path);
+    test_corrupt(path);
+
+    remove(path);
+    rmdir(dir);
+
+    printf("test_pack: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
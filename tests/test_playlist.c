@@ -0,0 +1,208 @@
+/*
+ * test_playlist - play orders of playlist.c
+ *
+ * Lays out play ranges of a small catalog, audio tracks 1 to 8 with a data
+ * track at 6, and checks
+ *   - the fixed orders of the table below: sequential and forced
+ *     sequential, data tracks included, ranges past the catalog cut short
+ *   - shuffle starting at the requested track and playing every other
+ *     audio track of the range once, each one equally likely to come next
+ *   - weighted picks never taking a track of weight 0 or the same track
+ *     twice in a row, and drawing the first pick with the configured odds
+ *   - playlist_next() and playlist_peek() walking the order
+ *
+ * usage: test_playlist
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../catalog.h"
+#include "../playlist.h"
+
+#define SLOTS       9
+#define DATA_TRACK  6
+#define RUNS        16000
+
+static int failures = 0;
+
+#define check(cond, ...) do { if (!(cond)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+static struct catalog *cat;
+
+/* weight of track i, set by file name in main() */
+static const int weights[SLOTS] = { 0, 1, 0, 3, 2, 1, 0, 1, 1 };
+
+static const struct
+{
+    const char *name;
+    int order;
+    int sequential;
+    int first;
+    int last;
+    int want[SLOTS + 1];    /* ends with 0 */
+}
+fixed[] =
+{
+    { "sequential",                 PLAYLIST_SEQUENTIAL, 0, 2, 7,  { 2, 3, 4, 5, 6, 7 } },
+    { "sequential past the end",    PLAYLIST_SEQUENTIAL, 0, 7, 99, { 7, 8 } },
+    { "shuffle forced sequential",  PLAYLIST_SHUFFLE,    1, 3, 6,  { 3, 4, 5, 6 } },
+    { "weighted forced sequential", PLAYLIST_WEIGHTED,   1, 1, 3,  { 1, 2, 3 } },
+    { "one track",                  PLAYLIST_SHUFFLE,    0, 5, 5,  { 5 } },
+    { "weighted, one track",        PLAYLIST_WEIGHTED,   0, 8, 8,  { 8 } },
+    { "weighted, only weight 0",    PLAYLIST_WEIGHTED,   0, 1, 2,  { 1 } },
+};
+
+/* the whole order, returns its length */
+static int take(int *list)
+{
+    int n = 0, t;
+
+    while ((t = playlist_next()) != 0 && n < 64)
+        list[n++] = t;
+
+    return n;
+}
+
+static void test_fixed()
+{
+    int list[64];
+    int c, n, i;
+
+    for (c = 0; c < sizeof fixed / sizeof *fixed; c++)
+    {
+        playlist_order(fixed[c].order);
+        playlist_start(cat, fixed[c].first, fixed[c].last, fixed[c].sequential);
+        n = take(list);
+
+        for (i = 0; i < n && fixed[c].want[i] == list[i]; i++)
+            ;
+
+        check(i == n && fixed[c].want[n] == 0, "%s: track %d is %d, not %d", fixed[c].name, i, i < n ? list[i] : 0, fixed[c].want[i]);
+    }
+}
+
+static void test_shuffle()
+{
+    int list[64], seen[SLOTS], second[SLOTS] = { 0 };
+    int r, n, i;
+
+    playlist_order(PLAYLIST_SHUFFLE);
+
+    for (r = 0; r < RUNS; r++)
+    {
+        playlist_start(cat, 2, 8, 0);
+        n = take(list);
+        memset(seen, 0, sizeof seen);
+
+        for (i = 0; i < n; i++)
+            seen[list[i]]++;
+
+        check(n == 6 && list[0] == 2, "shuffle of 2-8 has %d tracks starting with %d", n, list[0]);
+        check(seen[2] == 1 && seen[3] == 1 && seen[4] == 1 && seen[5] == 1 && seen[7] == 1 && seen[8] == 1 && !seen[DATA_TRACK],
+            "shuffle of 2-8 doesn't play every audio track once");
+
+        if (n > 1)
+            second[list[1]]++;
+
+        if (failures)
+            return;
+    }
+
+    /* 5 tracks can follow the first, 3200 times each */
+    for (i = 3; i < SLOTS; i++)
+    {
+        if (i != DATA_TRACK)
+            check(second[i] > RUNS / 5 * 9 / 10 && second[i] < RUNS / 5 * 11 / 10, "shuffle picks track %d second %d times of %d", i, second[i], RUNS);
+    }
+}
+
+static void test_weighted()
+{
+    int list[64], first[SLOTS] = { 0 };
+    int r, n, i, sum = 0;
+
+    playlist_order(PLAYLIST_WEIGHTED);
+
+    for (r = 0; r < RUNS; r++)
+    {
+        playlist_start(cat, 1, 8, 0);
+        n = take(list);
+
+        /* 7 audio tracks in the range, the first one included */
+        check(n == 7 && list[0] == 1, "weighted 1-8 has %d tracks starting with %d", n, list[0]);
+
+        for (i = 1; i < n; i++)
+        {
+            check(weights[list[i]] > 0, "weighted picks track %d of weight 0", list[i]);
+            check(list[i] != list[i - 1], "weighted picks track %d twice in a row", list[i]);
+        }
+
+        if (n > 1)
+            first[list[1]]++;
+
+        if (failures)
+            return;
+    }
+
+    /* the first pick is from everything but track 1 */
+    for (i = 2; i < SLOTS; i++)
+        sum += weights[i];
+
+    for (i = 2; i < SLOTS; i++)
+    {
+        int want = RUNS * weights[i] / sum;
+
+        check(first[i] >= want * 9 / 10 && first[i] <= want * 11 / 10, "weighted picks track %d first %d times, not about %d", i, first[i], want);
+    }
+}
+
+static void test_walk()
+{
+    playlist_order(PLAYLIST_SEQUENTIAL);
+    playlist_start(cat, 4, 5, 0);
+
+    check(playlist_peek() == 4 && playlist_peek() == 4, "peek moves on");
+    check(playlist_next() == 4 && playlist_peek() == 5, "next doesn't move on");
+    check(playlist_next() == 5 && playlist_peek() == 0 && playlist_next() == 0, "the order doesn't end");
+}
+
+int main()
+{
+    char name[16];
+    int i;
+
+    cat = calloc(1, sizeof *cat + SLOTS * sizeof *cat->tracks);
+
+    if (!cat)
+        return 1;
+
+    cat->slots = SLOTS;
+    cat->firstTrack = 1;
+    cat->lastTrack = SLOTS - 1;
+
+    for (i = 1; i < SLOTS; i++)
+    {
+        if (i == DATA_TRACK)
+            continue;
+
+        snprintf(cat->tracks[i].path, sizeof cat->tracks[i].path, "/music/%02d.ogg", i);
+
+        /* names match without case */
+        snprintf(name, sizeof name, i % 2 ? "%02d.OGG" : "%02d.ogg", i);
+        if (weights[i] != 1)
+            playlist_weight(name, weights[i]);
+    }
+
+    test_fixed();
+    test_shuffle();
+    test_weighted();
+    test_walk();
+
+    free(cat);
+
+    printf("test_playlist: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
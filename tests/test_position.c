@@ -0,0 +1,170 @@
+/*
+ * test_position - the position reported across a gapless track change
+ *
+ * Runs the core natively against the simulated sink in real time with a
+ * deep output queue, plays the end of one track into the next, which the
+ * player queues right behind it on the open device, and polls the status
+ * all the way. Fails when
+ *   - the position runs ahead of the time played, as it does when the
+ *     next track is reported while the queued end of the previous one
+ *     still plays
+ *   - the current track changes before the position got to its start
+ *   - the next track is never reported
+ * Then an empty music folder, in CD and folder mode, must report position
+ * and track 0 in every time format and refuse to play.
+ *
+ * The sample has to play for a few seconds, 5 are enough.
+ *
+ * usage: test_position sample.ogg
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../catalog.h"
+#include "../core.h"
+#include "../os.h"
+#include "../player.h"
+#include "../sink.h"
+#include "../stats.h"
+#include "sample.h"
+
+#define FIRST_TRACK 2
+#define LAST_TRACK  3
+#define BLOCK_MS    20
+#define BUFFERS     16          /* 320 ms queued when the track changes */
+#define LEAD_MS     1500        /* played of the first track */
+#define POLL_MS     3000
+#define SLACK_MS    (BLOCK_MS + 14)     /* a block, a frame and rounding */
+
+static void test_switch()
+{
+    MCI_SET_PARMS set;
+    MCI_PLAY_PARMS play;
+    DWORD second, from, pos, track, last_pos = 0;
+    double ahead = -1e9, switched = -1;
+    uint64_t t0;
+
+    set.dwTimeFormat = MCI_FORMAT_MILLISECONDS;
+    core_command(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&set);
+
+    second = sample_status(MCI_STATUS_POSITION, LAST_TRACK);
+    from = second - LEAD_MS;
+
+    memset(&play, 0, sizeof play);
+    play.dwFrom = from;
+    core_command(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM, (DWORD_PTR)&play);
+    t0 = os_ticks();
+
+    while (sample_ms_since(t0) < POLL_MS)
+    {
+        double ms = sample_ms_since(t0);
+
+        pos = sample_status(MCI_STATUS_POSITION, 0);
+        track = sample_status(MCI_STATUS_CURRENT_TRACK, 0);
+
+        if ((double)pos - from - ms > ahead)
+            ahead = (double)pos - from - ms;
+
+        check(pos >= last_pos, "position went back from %u to %u ms", (unsigned)last_pos, (unsigned)pos);
+        check(track == (pos >= second ? LAST_TRACK : FIRST_TRACK), "track %u reported at %u ms, track %d starts at %u ms",
+            (unsigned)track, (unsigned)pos, LAST_TRACK, (unsigned)second);
+
+        if (track == LAST_TRACK && switched < 0)
+            switched = ms;
+
+        last_pos = pos;
+        os_sleep(2);
+    }
+
+    core_command(MAGIC_DEVICEID, MCI_STOP, 0, 0);
+
+    printf("switch: track %d reported after %.0f ms of %d ms, position at most %.0f ms ahead, %d ms allowed\n",
+        LAST_TRACK, switched, LEAD_MS, ahead, SLACK_MS);
+
+    check(switched >= 0, "track %d never reported", LAST_TRACK);
+    check(switched < 0 || switched >= LEAD_MS - SLACK_MS, "track %d reported after %.0f ms, its start is %d ms away", LAST_TRACK, switched, LEAD_MS);
+    check(ahead <= SLACK_MS, "position ran %.0f ms ahead of the time played", ahead);
+}
+
+/* no audio track to index the catalog with */
+static void test_empty()
+{
+    static const DWORD formats[] = { MCI_FORMAT_MILLISECONDS, MCI_FORMAT_MSF, MCI_FORMAT_TMSF };
+    char dir[] = "/tmp/oggemptyXXXXXX", ret[64];
+    MCI_SET_PARMS set;
+    MCI_PLAY_PARMS play;
+    int mode, f;
+
+    if (!mkdtemp(dir))
+    {
+        check(0, "can't make an empty folder");
+        return;
+    }
+
+    for (mode = CATALOG_CD; mode <= CATALOG_FOLDER; mode++)
+    {
+        core_scan(dir, mode);
+
+        for (f = 0; f < sizeof formats / sizeof *formats; f++)
+        {
+            set.dwTimeFormat = formats[f];
+            core_command(MAGIC_DEVICEID, MCI_SET, MCI_SET_TIME_FORMAT, (DWORD_PTR)&set);
+
+            check(sample_status(MCI_STATUS_POSITION, 0) == 0, "empty folder, mode %d: position isn't 0", mode);
+            check(sample_status(MCI_STATUS_CURRENT_TRACK, 0) == 0, "empty folder, mode %d: current track isn't 0", mode);
+            check(core_string("status cdaudio position", ret, sizeof ret, NULL) == 0, "empty folder, mode %d: status position fails", mode);
+
+            memset(&play, 0, sizeof play);
+            play.dwFrom = formats[f] == MCI_FORMAT_TMSF ? MCI_MAKE_TMSF(2, 0, 1, 0) : 1000;
+            check(core_command(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM, (DWORD_PTR)&play) == MCIERR_DEVICE_NOT_READY, "empty folder, mode %d: play from doesn't fail", mode);
+            check(core_command(MAGIC_DEVICEID, MCI_PLAY, 0, 0) == MCIERR_DEVICE_NOT_READY, "empty folder, mode %d: play doesn't fail", mode);
+            check(sample_status(MCI_STATUS_MODE, 0) == MCI_MODE_STOP, "empty folder, mode %d: not stopped after play", mode);
+        }
+    }
+
+    rmdir(dir);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct core_host host = { core_command, sample_ignore_notify };
+    char dir[] = "/tmp/oggpositionXXXXXX", cwd[1024], sample[1024];
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: test_position sample.ogg\n");
+        return 1;
+    }
+
+    if (!getcwd(cwd, sizeof cwd) || !realpath(argv[1], sample) || !sample_folder(sample, dir, FIRST_TRACK, LAST_TRACK) || chdir(dir) != 0)
+    {
+        fprintf(stderr, "%s: can't set up the track folder\n", argv[1]);
+        return 1;
+    }
+
+    alarm(120);
+
+    stat_init();
+    plr_init();
+    plr_buffering(BLOCK_MS, BUFFERS, BUFFERS);
+    core_init(&host);
+    core_scan(dir, 0);
+
+    core_command(MAGIC_DEVICEID, MCI_OPEN, 0, 0);
+
+    test_switch();
+    test_empty();
+
+    core_command(MAGIC_DEVICEID, MCI_CLOSE, 0, 0);
+
+    sample_remove(dir, FIRST_TRACK, LAST_TRACK);
+
+    if (chdir(cwd) != 0)
+        return 1;
+
+    printf("test_position: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * test_seek - seek tables of seek.c
+ *
+ * Lays out Ogg page headers as in the table below, with pages of another
+ * logical stream and pages that end no packet mixed in, and checks that
+ * every point seek_build() gives is the last page of the stream ending at
+ * or before its sample. Then seek_find() is checked at the edges of every
+ * interval and past both ends of the table.
+ *
+ * usage: test_seek
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../seek.h"
+
+#define MAX_PAGES   8
+#define MAX_POINTS  8
+#define START       -1      /* the start of the stream, granule 0 */
+
+static int failures = 0;
+
+#define check(cond, ...) do { if (!(cond)) { failures++; fprintf(stderr, __VA_ARGS__); fputc('\n', stderr); } } while (0)
+
+struct page
+{
+    uint32_t serial;
+    int64_t granule;        /* -1 when no packet ends on the page */
+    int body;               /* bytes */
+};
+
+static const struct
+{
+    const char *name;
+    int64_t samples;
+    uint32_t interval;
+    int count;              /* points, 0 if seek_build() should fail */
+    struct page pages[MAX_PAGES];
+    int want[MAX_POINTS];   /* page of each point */
+}
+cases[] =
+{
+    {
+        "one stream", 3000, 1000, 4,
+        { { 1, 0, 30 }, { 1, 0, 200 }, { 1, 500, 255 }, { 1, 1100, 255 }, { 1, 1900, 100 }, { 1, 2600, 300 }, { 1, 3000, 17 } },
+        { 1, 2, 4, 6 }
+    },
+    {
+        "other streams and continued packets", 2500, 1000, 3,
+        { { 1, 0, 30 }, { 2, 5000, 40 }, { 1, -1, 255 }, { 1, 800, 90 }, { 2, 100, 10 }, { 1, 2500, 60 } },
+        { 0, 3, 3 }
+    },
+    {
+        "shorter than its length", 3000, 1000, 4,
+        { { 1, 0, 30 }, { 1, 400, 50 } },
+        { 0, 1, 1, 1 }
+    },
+    {
+        "no page before the second point", 3000, 1000, 4,
+        { { 7, 1500, 30 }, { 7, 3000, 30 } },
+        { START, START, 0, 1 }
+    },
+    {
+        "point on a page boundary", 2000, 500, 5,
+        { { 1, 0, 10 }, { 1, 500, 10 }, { 1, 1000, 10 }, { 1, 1001, 10 }, { 1, 2000, 10 } },
+        { 0, 1, 2, 3, 4 }
+    },
+    {
+        "no table without an interval", 3000, 0, 0,
+        { { 1, 0, 30 } },
+        { 0 }
+    },
+};
+
+static unsigned char ogg[MAX_PAGES * (27 + 2 + 512)];
+
+static void put_le(unsigned char *p, uint64_t v, int bytes)
+{
+    while (bytes--)
+    {
+        *p++ = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+/* page headers and segment tables with zeroed bodies, fills offsets;
+ * returns the size of the stream */
+static size_t build(const struct page *pages, uint64_t *offsets)
+{
+    size_t pos = 0;
+    int i;
+
+    memset(ogg, 0, sizeof ogg);
+
+    for (i = 0; i < MAX_PAGES && pages[i].body; i++)
+    {
+        unsigned char *p = ogg + pos;
+        int body = pages[i].body, segs = body / 255 + 1, s;
+
+        offsets[i] = pos;
+        memcpy(p, "OggS", 4);
+        put_le(p + 6, (uint64_t)pages[i].granule, 8);
+        put_le(p + 14, pages[i].serial, 4);
+        put_le(p + 18, i, 4);
+        p[26] = segs;
+
+        for (s = 0; s < segs; s++)
+            p[27 + s] = s < segs - 1 ? 255 : body % 255;
+
+        pos += 27 + segs + body;
+    }
+
+    return pos;
+}
+
+static void test_build()
+{
+    struct seek_point points[MAX_POINTS];
+    uint64_t offsets[MAX_PAGES];
+    int c, k;
+
+    for (c = 0; c < sizeof cases / sizeof *cases; c++)
+    {
+        size_t size = build(cases[c].pages, offsets);
+        int count = seek_build(ogg, size, cases[c].samples, cases[c].interval, points);
+
+        check(count == cases[c].count, "%s: %d points, not %d", cases[c].name, count, cases[c].count);
+
+        for (k = 0; k < count && k < cases[c].count; k++)
+        {
+            int page = cases[c].want[k];
+            int64_t granule = page == START ? 0 : cases[c].pages[page].granule;
+            uint64_t offset = page == START ? 0 : offsets[page];
+
+            check(points[k].granule == granule && points[k].offset == offset, "%s: point %d is granule %lld at %llu, not %lld at %llu",
+                cases[c].name, k, (long long)points[k].granule, (unsigned long long)points[k].offset, (long long)granule, (unsigned long long)offset);
+        }
+    }
+
+    memset(ogg, 0x5A, sizeof ogg);
+    check(seek_build(ogg, sizeof ogg, 3000, 1000, points) == 0, "a table is built from no Ogg stream");
+    check(seek_build(ogg, 0, 3000, 1000, points) == 0, "a table is built from nothing");
+}
+
+static void test_find()
+{
+    struct seek_point points[4];
+    int64_t sample;
+
+    for (sample = -1; sample <= 4001; sample++)
+    {
+        const struct seek_point *p = seek_find(points, 4, 1000, sample);
+        const struct seek_point *want = sample >= 0 && sample < 4000 ? &points[sample / 1000] : NULL;
+
+        check(p == want, "sample %lld finds point %d", (long long)sample, p ? (int)(p - points) : -1);
+    }
+
+    check(!seek_find(points, 4, 0, 0), "a table without an interval finds a point");
+    check(!seek_find(points, 0, 1000, 0), "an empty table finds a point");
+    check(seek_find(points, 4, 1000, INT64_MAX - 1) == NULL, "a sample far past the table finds a point");
+}
+
+int main()
+{
+    test_build();
+    test_find();
+
+    printf("test_seek: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
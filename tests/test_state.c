@@ -0,0 +1,236 @@
+/*
+ * test_state - the device state machine under several game threads
+ *
+ * Runs the core natively against the simulated sink, with tracks 2 to 4
+ * made of copies of the sample and playing 500 times faster than real time
+ * so the mostly short ranges finish while the threads keep sending
+ * commands. Every thread
+ * sends random play, stop, pause, resume, close, open and status commands
+ * and checks what it can see on its own:
+ *   - the mode is one of the four MCI modes
+ *   - positions and the current track lie on the disc
+ * Once all threads are done:
+ *   - every play that asked for a notification got exactly one
+ *   - stop leaves the device stopped with nothing queued on the sink
+ *   - a play still runs to its end and notifies success
+ *   - close and open still work, sysinfo still counts one device
+ * A deadlock is caught by an alarm.
+ *
+ * usage: test_state sample.ogg
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../cdtime.h"
+#include "../core.h"
+#include "../os.h"
+#include "../player.h"
+#include "../sink.h"
+#include "../stats.h"
+#include "sample.h"
+
+#define THREADS     4
+#define COMMANDS    1500
+#define FIRST_TRACK 2
+#define LAST_TRACK  4
+#define HWND_BASE   0x10000         /* clear of the 0xffff broadcast */
+
+static volatile LONG plays = 0;
+static volatile LONG notified[THREADS * COMMANDS + 2];     /* by play, from 1 */
+static volatile LONG ended = 0;            /* notified successful */
+static volatile LONG stray = 0;
+static volatile LONG last_status = 0;
+
+static void host_notify(HWND hwnd, WPARAM status)
+{
+    uintptr_t id = (uintptr_t)hwnd - HWND_BASE;
+
+    if ((uintptr_t)hwnd < HWND_BASE || id >= sizeof notified / sizeof *notified)
+    {
+        os_add(&stray, 1);
+        return;
+    }
+
+    os_add(&notified[id], 1);
+    os_xchg(&last_status, (LONG)status);
+
+    if (status == MCI_NOTIFY_SUCCESSFUL)
+        os_add(&ended, 1);
+}
+
+static int valid_mode(DWORD mode)
+{
+    return mode == MCI_MODE_PLAY || mode == MCI_MODE_PAUSE || mode == MCI_MODE_STOP || mode == MCI_MODE_NOT_READY;
+}
+
+/* From the start of track first to frames into track last, or to the end of
+ * the disc for 0 frames; notifies the given id if it isn't 0. */
+static void play(int first, int last, int frames, uintptr_t id)
+{
+    MCI_PLAY_PARMS parms;
+
+    parms.dwCallback = id ? HWND_BASE + id : 0;
+    parms.dwFrom = MCI_MAKE_TMSF(first, 0, 0, 0);
+    parms.dwTo = MCI_MAKE_TMSF(last, 0, frames / CD_FPS, frames % CD_FPS);
+
+    core_command(MAGIC_DEVICEID, MCI_PLAY, MCI_FROM | (frames ? MCI_TO : 0) | (id ? MCI_NOTIFY : 0), (DWORD_PTR)&parms);
+}
+
+static int game_thread(void *arg)
+{
+    unsigned seed = (unsigned)(uintptr_t)arg;
+    int i;
+
+    for (i = 0; i < COMMANDS; i++)
+    {
+        int first = FIRST_TRACK + rand_r(&seed) % (LAST_TRACK - FIRST_TRACK + 1);
+        int last = first + rand_r(&seed) % (LAST_TRACK - first + 1);
+        int frames = rand_r(&seed) % 8 ? 1 + rand_r(&seed) % CD_FPS : 0;
+        DWORD v;
+
+        switch (rand_r(&seed) % 10)
+        {
+            case 0:
+            case 1:
+                play(first, last, frames, rand_r(&seed) % 2 ? (uintptr_t)os_add(&plays, 1) + 1 : 0);
+                break;
+
+            case 2:
+                core_command(MAGIC_DEVICEID, MCI_STOP, 0, 0);
+                break;
+
+            case 3:
+                core_command(MAGIC_DEVICEID, MCI_PAUSE, 0, 0);
+                break;
+
+            case 4:
+                core_command(MAGIC_DEVICEID, MCI_RESUME, 0, 0);
+                break;
+
+            case 5:
+                if (rand_r(&seed) % 4 == 0)
+                    core_command(MAGIC_DEVICEID, MCI_CLOSE, 0, 0);
+                else
+                    core_command(MAGIC_DEVICEID, MCI_OPEN, 0, 0);
+                break;
+
+            case 6:
+                v = sample_status(MCI_STATUS_POSITION, 0);
+                check(MCI_TMSF_TRACK(v) >= 1 && MCI_TMSF_TRACK(v) <= LAST_TRACK, "position %08X is off the disc", (unsigned)v);
+                break;
+
+            case 7:
+                v = sample_status(MCI_STATUS_CURRENT_TRACK, 0);
+                check(v >= 1 && v <= LAST_TRACK, "current track %u is off the disc", (unsigned)v);
+                break;
+
+            default:
+                v = sample_status(MCI_STATUS_MODE, 0);
+                check(valid_mode(v), "mode %u is no MCI mode", (unsigned)v);
+                break;
+        }
+
+        /* give the player thread time to get somewhere, now and then to
+         * the end of a short range */
+        if (rand_r(&seed) % 2 == 0)
+            os_sleep(rand_r(&seed) % 8 ? rand_r(&seed) % 3 : 20);
+    }
+
+    return 0;
+}
+
+static void test_stress()
+{
+    os_thread threads[THREADS];
+    int i;
+
+    for (i = 0; i < THREADS; i++)
+        threads[i] = os_thread_start(game_thread, (void *)(uintptr_t)(i + 1), 0);
+
+    for (i = 0; i < THREADS; i++)
+        os_thread_join(threads[i]);
+
+    core_command(MAGIC_DEVICEID, MCI_STOP, 0, 0);
+
+    check(sample_status(MCI_STATUS_MODE, 0) == MCI_MODE_STOP, "not stopped after stop");
+    check(sink_queued() == 0, "%d blocks still queued after stop", sink_queued());
+    check(stray == 0, "%d notifications for windows that asked for none", (int)stray);
+
+    for (i = 1; i <= plays; i++)
+        check(notified[i] == 1, "play %d notified %d times", i, (int)notified[i]);
+
+    printf("%d commands from %d threads, %d plays notified, %d of them at their end\n", THREADS * COMMANDS, THREADS, (int)plays, (int)ended);
+}
+
+/* the machine still works after the stress */
+static void test_after()
+{
+    uintptr_t id = (uintptr_t)os_add(&plays, 1) + 1;
+    int ms;
+
+    os_xchg(&last_status, 0);
+    play(LAST_TRACK, LAST_TRACK, 0, id);
+    check(sample_status(MCI_STATUS_MODE, 0) == MCI_MODE_PLAY, "not playing after play");
+
+    for (ms = 0; sample_status(MCI_STATUS_MODE, 0) == MCI_MODE_PLAY && ms < 10000; ms += 10)
+        os_sleep(10);
+
+    check(sample_status(MCI_STATUS_MODE, 0) == MCI_MODE_STOP, "not stopped at the end of the range");
+    check(notified[id] == 1 && last_status == MCI_NOTIFY_SUCCESSFUL, "end of range not notified as successful");
+
+    core_command(MAGIC_DEVICEID, MCI_CLOSE, 0, 0);
+    check(sample_status(MCI_STATUS_MODE, 0) == MCI_MODE_NOT_READY, "not closed after close");
+
+    core_command(MAGIC_DEVICEID, MCI_OPEN, 0, 0);
+    check(sample_status(MCI_STATUS_MODE, 0) == MCI_MODE_STOP, "not stopped after open");
+
+    DWORD quantity = 0;
+    MCI_SYSINFO_PARMS info = { 0, (LPSTR)&quantity, sizeof quantity, 0, 0 };
+
+    check(core_command(MAGIC_DEVICEID, MCI_SYSINFO, MCI_SYSINFO_QUANTITY, (DWORD_PTR)&info) == 0 && quantity == 1, "sysinfo counts %u devices", (unsigned)quantity);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct core_host host = { core_command, host_notify };
+    char dir[] = "/tmp/oggstateXXXXXX", cwd[1024], sample[1024];
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: test_state sample.ogg\n");
+        return 1;
+    }
+
+    if (!getcwd(cwd, sizeof cwd) || !realpath(argv[1], sample) || !sample_folder(sample, dir, FIRST_TRACK, LAST_TRACK) || chdir(dir) != 0)
+    {
+        fprintf(stderr, "%s: can't set up the track folder\n", argv[1]);
+        return 1;
+    }
+
+    /* a deadlock fails the test instead of hanging it */
+    alarm(120);
+
+    stat_init();
+    plr_init();
+    core_init(&host);
+    core_scan(dir, 0);
+    sink_sim_speed = 500;
+
+    core_command(MAGIC_DEVICEID, MCI_OPEN, 0, 0);
+
+    test_stress();
+    test_after();
+
+    core_command(MAGIC_DEVICEID, MCI_CLOSE, 0, 0);
+
+    sample_remove(dir, FIRST_TRACK, LAST_TRACK);
+
+    if (chdir(cwd) != 0)
+        return 1;
+
+    printf("test_state: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,670 @@
+/*
+ * bench - performance numbers for the emulator core
+ *
+ * Runs the core natively against a simulated sink and measures:
+ *   - scanning a 99 track folder made of copies of the sample, in CD and in
+ *     folder mode, and startup from the same tracks packed into music.pak
+ *   - "play from" a random position in an archive track, with and without
+ *     its seek table
+ *   - decoding the sample, as a multiple of real time
+ *   - what the counters and histograms of stats.c add to the player's
+ *     decode loop, in percent, which must stay under STATS_BUDGET_PCT
+ *   - plr_pump() latency percentiles
+ *   - parsing and dispatching MCI strings, per command
+ *   - the player's gain kernel
+ *   - the loudness analysis oggpack runs on every track
+ *   - "play" to the first block reaching the sink, per latency profile
+ *
+ * Results are written as JSON to stdout or -o. With -b the results are
+ * compared against an earlier JSON file and every metric that got worse by
+ * more than the threshold (-t, percent, default 10) is reported as a
+ * regression, which also makes the exit status non-zero. Results that are
+ * percentages themselves (_pct) regress when they grow by more than one
+ * point. A result over its budget fails the run with or without -b.
+ *
+ * usage: bench [-o out.json] [-b baseline.json] [-t percent] [-s seconds] sample.ogg
+ */
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vorbis/vorbisfile.h>
+
+#include "../core.h"
+#include "../loudness.h"
+#include "../os.h"
+#include "../pack.h"
+#include "../player.h"
+#include "../sink.h"
+#include "../stats.h"
+
+#define MAX_RESULTS 64
+#define SCAN_TRACKS 99
+#define PLAY_RUNS   50
+#define SEEK_RUNS   200
+#define SEEK_MS     500     /* oggpack's default */
+
+/* the most the stats may add to a real Vorbis decode */
+#define STATS_BUDGET_PCT 1.0
+
+struct result
+{
+    char name[48];
+    double value;
+    int higher_is_better;
+    double budget;          /* highest value allowed, 0 for none */
+};
+
+static struct result results[MAX_RESULTS];
+static int num_results = 0;
+static double seconds = 1.0;
+
+static double elapsed(uint64_t t0)
+{
+    return (double)(os_ticks() - t0) / os_ticks_per_sec();
+}
+
+static void add_result(const char *name, double value, int higher_is_better)
+{
+    if (num_results == MAX_RESULTS)
+        return;
+
+    snprintf(results[num_results].name, sizeof results[num_results].name, "%s", name);
+    results[num_results].value = value;
+    results[num_results].higher_is_better = higher_is_better;
+    results[num_results].budget = 0;
+    num_results++;
+
+    fprintf(stderr, "%-36s %12.2f\n", name, value);
+}
+
+/* a result that fails the run above budget */
+static void add_budget(const char *name, double value, double budget)
+{
+    add_result(name, value, 0);
+
+    if (num_results && !strcmp(results[num_results - 1].name, name))
+        results[num_results - 1].budget = budget;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* adds name_p50 and name_p99 from n samples, sorts them; the maximum is
+ * left out as it is too noisy to compare */
+static void add_percentiles(const char *name, double *v, int n)
+{
+    char buf[48];
+
+    if (n == 0)
+        return;
+
+    qsort(v, n, sizeof *v, cmp_double);
+
+    snprintf(buf, sizeof buf, "%s_p50", name);
+    add_result(buf, v[n / 2], 0);
+    snprintf(buf, sizeof buf, "%s_p99", name);
+    add_result(buf, v[(n - 1) * 99 / 100], 0);
+}
+
+static void host_notify(HWND hwnd, WPARAM status)
+{
+}
+
+/* the core scanning a folder of SCAN_TRACKS copies of the sample */
+static void bench_scan(const char *name, const char *dir, int folder_mode)
+{
+    int runs = 0;
+    uint64_t t0 = os_ticks();
+
+    do
+    {
+        core_scan(dir, folder_mode);
+        runs++;
+    } while (elapsed(t0) < seconds);
+
+    add_result(name, elapsed(t0) * 1000 / runs, 0);
+}
+
+/* startup from music.pak: mapping it and reading the index each time */
+static void bench_scan_pack(const char *dir)
+{
+    int runs = 0;
+    uint64_t t0 = os_ticks();
+
+    do
+    {
+        pack_close();
+        core_scan(dir, 0);
+        runs++;
+    } while (elapsed(t0) < seconds);
+
+    pack_close();
+    add_result("scan_99_tracks_pack_ms", elapsed(t0) * 1000 / runs, 0);
+}
+
+/* plr_play() from random positions of the open first track of an archive,
+ * which is the seek alone once the track is open */
+static void bench_seek(const char *name, const char *pack)
+{
+    const struct pack_entry *e;
+    double v[SEEK_RUNS];
+    char path[600];
+    int i;
+
+    pack_close();
+
+    if (!pack_open(pack) || !pack_index(&e))
+        return;
+
+    snprintf(path, sizeof path, "%s#%02u", pack, (unsigned)e[0].track);
+    plr_play(path, 0, -1);
+
+    for (i = 0; i < SEEK_RUNS; i++)
+    {
+        int64_t from = (int64_t)(rand() / (RAND_MAX + 1.0) * e[0].samples);
+        uint64_t t0 = os_ticks();
+
+        plr_play(path, from, -1);
+        v[i] = elapsed(t0) * 1e6;
+    }
+
+    plr_stop();
+    pack_close();
+
+    add_percentiles(name, v, SEEK_RUNS);
+}
+
+/* raw vorbisfile decoding, no player around it */
+static void bench_decode(const char *path)
+{
+    static char buf[4096];
+    double audio = 0, dt;
+    uint64_t t0 = os_ticks();
+
+    do
+    {
+        OggVorbis_File vf;
+        vorbis_info *vi;
+        long bytes;
+
+        if (ov_fopen(path, &vf) != 0)
+            return;
+
+        vi = ov_info(&vf, -1);
+
+        while ((bytes = ov_read(&vf, buf, sizeof buf, 0, 2, 1, NULL)) != 0)
+        {
+            if (bytes > 0)
+                audio += (double)bytes / (vi->channels * 2) / vi->rate;
+        }
+
+        ov_clear(&vf);
+    } while ((dt = elapsed(t0)) < seconds);
+
+    add_result("decode_realtime_factor", audio / dt, 1);
+}
+
+/* the player thread's loop with a sink that never makes it wait */
+static void bench_pump(const char *path)
+{
+    int n = 0, cap = 4096;
+    double *v = malloc(cap * sizeof *v);
+
+    sink_sim_speed = 1e6;
+
+    if (!plr_play(path, 0, -1))
+    {
+        free(v);
+        return;
+    }
+
+    while (1)
+    {
+        uint64_t t0 = os_ticks();
+        int more = plr_pump();
+
+        if (!more)
+            break;
+
+        if (n == cap)
+            v = realloc(v, (cap *= 2) * sizeof *v);
+
+        v[n++] = elapsed(t0) * 1e6;
+    }
+
+    plr_stop();
+    sink_sim_speed = 1.0;
+
+    add_percentiles("pump_us", v, n);
+    free(v);
+}
+
+/* The player's decode loop over the whole sample with stats.c recording
+ * and with it off, alternating so that drift hits both alike. */
+static void bench_stats(const char *path)
+{
+    double t[2] = { 0, 0 };
+    uint64_t t0 = os_ticks();
+    int on;
+
+    sink_sim_speed = 1e6;
+
+    do
+    {
+        for (on = 0; on < 2; on++)
+        {
+            uint64_t t1;
+
+            stat_enable(on);
+
+            if (!plr_play(path, 0, -1))
+                break;
+
+            t1 = os_ticks();
+
+            while (plr_pump())
+                ;
+
+            t[on] += elapsed(t1);
+            plr_stop();
+        }
+    } while (elapsed(t0) < 2 * seconds && on == 2);
+
+    stat_enable(1);
+    sink_sim_speed = 1.0;
+
+    if (t[0] > 0)
+        add_budget("decode_stats_overhead_pct", (t[1] - t[0]) / t[0] * 100, STATS_BUDGET_PCT);
+}
+
+/* one string command, repeated, with the device open and stopped */
+static void bench_string(const char *name, const char *cmd)
+{
+    char ret[128], buf[48];
+    long ops = 0;
+    uint64_t t0 = os_ticks();
+    double dt;
+
+    do
+    {
+        int i;
+
+        for (i = 0; i < 1000; i++)
+            core_string(cmd, ret, sizeof ret, NULL);
+
+        ops += 1000;
+    } while ((dt = elapsed(t0)) < seconds);
+
+    snprintf(buf, sizeof buf, "mci_%s_ns", name);
+    add_result(buf, dt * 1e9 / ops, 0);
+}
+
+static void bench_mci()
+{
+    core_string("open cdaudio", NULL, 0, NULL);
+
+    bench_string("status_mode", "status cdaudio mode");
+    bench_string("status_position", "status cdaudio position");
+    bench_string("status_length_track", "status cdaudio length track 2");
+    bench_string("status_tracks", "status cdaudio number of tracks");
+    bench_string("set_time_format", "set cdaudio time format tmsf");
+    bench_string("unknown", "window cdaudio handle 0");
+}
+
+/* 20 ms of full scale noise through the volume loop in plr_pump() */
+static void bench_gain()
+{
+    static short buf[44100 / 50 * 2];
+    long samples = 0;
+    uint64_t t0 = os_ticks();
+    double dt;
+    int i;
+
+    for (i = 0; i < sizeof buf / sizeof *buf; i++)
+        buf[i] = rand();
+
+    do
+    {
+        for (i = 0; i < 64; i++)
+            plr_gain(buf, sizeof buf / sizeof *buf, 0.7f);
+
+        samples += 64 * sizeof buf / sizeof *buf;
+    } while ((dt = elapsed(t0)) < seconds);
+
+    add_result("gain_msamples_per_s", samples / dt / 1e6, 1);
+}
+
+/* the same noise through the loudness analysis oggpack runs on every track */
+static void bench_loudness()
+{
+    static short buf[44100 / 50 * 2];
+    struct loudness *l = malloc(sizeof *l);
+    long samples = 0;
+    uint64_t t0 = os_ticks();
+    double dt;
+    int i;
+
+    for (i = 0; i < sizeof buf / sizeof *buf; i++)
+        buf[i] = rand();
+
+    loud_init(l, 44100, 2);
+
+    do
+    {
+        for (i = 0; i < 64; i++)
+            loud_add(l, buf, sizeof buf / sizeof *buf / 2);
+
+        samples += 64 * sizeof buf / sizeof *buf;
+    } while ((dt = elapsed(t0)) < seconds);
+
+    add_result("loudness_msamples_per_s", samples / dt / 1e6, 1);
+    free(l);
+}
+
+/* "play" to the first block on the sink, the game's music start delay, in
+ * every latency profile */
+static void bench_play()
+{
+    const struct plr_profile *p;
+    double v[PLAY_RUNS];
+    char name[48];
+    int i;
+
+    for (p = plr_profiles; p->name; p++)
+    {
+        plr_buffering(p->block_ms, p->min_buffers, p->max_buffers);
+
+        for (i = 0; i < PLAY_RUNS; i++)
+        {
+            uint64_t t0 = os_ticks();
+
+            core_string("play cdaudio from 2", NULL, 0, NULL);
+
+            /* yielding, a spinning thread starves the player on one core */
+            while (!sink_queued() && elapsed(t0) < 1)
+                sched_yield();
+
+            v[i] = elapsed(t0) * 1e6;
+
+            core_string("stop cdaudio", NULL, 0, NULL);
+        }
+
+        snprintf(name, sizeof name, "play_to_audio_%s_us", p->name);
+        add_percentiles(name, v, PLAY_RUNS);
+    }
+
+    /* back to the default for whatever runs next */
+    plr_buffering(plr_profiles[1].block_ms, plr_profiles[1].min_buffers, plr_profiles[1].max_buffers);
+}
+
+/* temporary folder with 01.ogg - 99.ogg, all copies of the sample, and
+ * one with them packed into music.pak and into plain.pak without seek
+ * tables */
+static int make_folder(const char *sample, char *dir, char *pack_dir)
+{
+    const char *files[SCAN_TRACKS];
+    int tracks[SCAN_TRACKS];
+    FILE *fp = fopen(sample, "rb");
+    char path[512];
+    long size;
+    char *data;
+    int i, ok;
+
+    if (!fp)
+        return 0;
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data = malloc(size);
+
+    if (fread(data, 1, size, fp) != size || !mkdtemp(dir))
+    {
+        fclose(fp);
+        free(data);
+        return 0;
+    }
+
+    fclose(fp);
+
+    for (i = 1; i <= SCAN_TRACKS; i++)
+    {
+        snprintf(path, sizeof path, "%s/%02d.ogg", dir, i);
+        fp = fopen(path, "wb");
+        if (fp)
+        {
+            fwrite(data, 1, size, fp);
+            fclose(fp);
+        }
+
+        files[i - 1] = strdup(path);
+        tracks[i - 1] = i;
+    }
+
+    free(data);
+
+    ok = mkdtemp(pack_dir) != NULL;
+
+    if (ok)
+    {
+        snprintf(path, sizeof path, "%s/" PACK_NAME, pack_dir);
+        ok = pack_write(path, files, tracks, SCAN_TRACKS, SEEK_MS, 0);
+        snprintf(path, sizeof path, "%s/plain.pak", pack_dir);
+        ok &= pack_write(path, files, tracks, SCAN_TRACKS, 0, 0);
+    }
+
+    for (i = 0; i < SCAN_TRACKS; i++)
+        free((char *)files[i]);
+
+    return ok;
+}
+
+static void remove_folder(const char *dir)
+{
+    char path[512];
+    int i;
+
+    for (i = 1; i <= SCAN_TRACKS; i++)
+    {
+        snprintf(path, sizeof path, "%s/%02d.ogg", dir, i);
+        remove(path);
+    }
+
+    /* plr_play() leaves its volume file in the working directory */
+    snprintf(path, sizeof path, "%s/winmm.ini", dir);
+    remove(path);
+    rmdir(dir);
+}
+
+static void remove_pack(const char *pack_dir)
+{
+    char path[512];
+
+    snprintf(path, sizeof path, "%s/" PACK_NAME, pack_dir);
+    remove(path);
+    snprintf(path, sizeof path, "%s/plain.pak", pack_dir);
+    remove(path);
+    rmdir(pack_dir);
+}
+
+static void write_json(FILE *fp)
+{
+    int i;
+
+    fprintf(fp, "{\n  \"version\": 1,\n  \"results\": {\n");
+
+    for (i = 0; i < num_results; i++)
+    {
+        fprintf(fp, "    \"%s\": { \"value\": %.3f, \"better\": \"%s\" }%s\n", results[i].name, results[i].value,
+            results[i].higher_is_better ? "higher" : "lower", i + 1 < num_results ? "," : "");
+    }
+
+    fprintf(fp, "  }\n}\n");
+}
+
+/* reads back what write_json() wrote, one result per line; returns the
+ * number of regressions */
+static int compare(const char *path, double threshold)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    int regressions = 0;
+
+    if (!fp)
+    {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(stderr, "\n%-36s %12s %12s %8s\n", "metric", "baseline", "now", "change");
+
+    while (fgets(line, sizeof line, fp))
+    {
+        char name[48];
+        double base;
+        int i;
+
+        if (sscanf(line, " \"%47[^\"]\": { \"value\": %lf", name, &base) != 2)
+            continue;
+
+        for (i = 0; i < num_results; i++)
+        {
+            struct result *r = &results[i];
+            double change;
+            int pct;
+
+            if (strcmp(r->name, name))
+                continue;
+
+            pct = strlen(name) > 4 && !strcmp(name + strlen(name) - 4, "_pct");
+            change = pct ? r->value - base : base ? (r->value - base) / base * 100 : 0;
+
+            fprintf(stderr, "%-36s %12.2f %12.2f %+7.1f%s", name, base, r->value, change, pct ? "pt" : "%");
+
+            if (pct ? change > 1 : r->higher_is_better ? change < -threshold : change > threshold)
+            {
+                fprintf(stderr, "  REGRESSION");
+                regressions++;
+            }
+
+            fprintf(stderr, "\n");
+        }
+    }
+
+    fclose(fp);
+
+    fprintf(stderr, "%d regression%s over %.0f%%\n", regressions, regressions == 1 ? "" : "s", threshold);
+    return regressions;
+}
+
+/* returns the number of results over their budget */
+static int over_budget()
+{
+    int i, over = 0;
+
+    for (i = 0; i < num_results; i++)
+    {
+        if (results[i].budget > 0 && results[i].value > results[i].budget)
+        {
+            fprintf(stderr, "%s is %.2f, over its budget of %.2f\n", results[i].name, results[i].value, results[i].budget);
+            over++;
+        }
+    }
+
+    return over;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct core_host host = { core_command, host_notify };
+    const char *out = NULL, *baseline = NULL;
+    char dir[] = "/tmp/oggbenchXXXXXX", pack_dir[] = "/tmp/oggpackXXXXXX", pack[64], cwd[1024], sample[1024];
+    double threshold = 10;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:b:t:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o': out = optarg; break;
+            case 'b': baseline = optarg; break;
+            case 't': threshold = atof(optarg); break;
+            case 's': seconds = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: bench [-o out.json] [-b baseline.json] [-t percent] [-s seconds] sample.ogg\n");
+                return 1;
+        }
+    }
+
+    if (optind + 1 != argc)
+    {
+        fprintf(stderr, "usage: bench [-o out.json] [-b baseline.json] [-t percent] [-s seconds] sample.ogg\n");
+        return 1;
+    }
+
+    if (!getcwd(cwd, sizeof cwd) || !realpath(argv[optind], sample) || !make_folder(sample, dir, pack_dir))
+    {
+        fprintf(stderr, "%s: can't set up the track folder\n", argv[optind]);
+        return 1;
+    }
+
+    if (chdir(dir) != 0)
+        return 1;
+
+    srand(1);
+    stat_init();
+    plr_init();
+    core_init(&host);
+
+    bench_scan("scan_99_tracks_folder_ms", dir, 1);
+    bench_scan_pack(pack_dir);
+
+    /* the CD mode catalog stays for the benchmarks below */
+    bench_scan("scan_99_tracks_ms", dir, 0);
+    bench_decode(sample);
+    bench_pump(sample);
+    bench_stats(sample);
+
+    snprintf(pack, sizeof pack, "%s/plain.pak", pack_dir);
+    bench_seek("seek_us", pack);
+    snprintf(pack, sizeof pack, "%s/" PACK_NAME, pack_dir);
+    bench_seek("seek_indexed_us", pack);
+    bench_mci();
+    bench_gain();
+    bench_loudness();
+    bench_play();
+
+    core_string("close cdaudio", NULL, 0, NULL);
+
+    remove_folder(dir);
+    remove_pack(pack_dir);
+
+    if (chdir(cwd) != 0)
+        return 1;
+
+    if (out)
+    {
+        FILE *fp = fopen(out, "w");
+
+        if (!fp)
+        {
+            perror(out);
+            return 1;
+        }
+
+        write_json(fp);
+        fclose(fp);
+    }
+    else
+    {
+        write_json(stdout);
+    }
+
+    return (baseline && compare(baseline, threshold) != 0) | (over_budget() != 0);
+}
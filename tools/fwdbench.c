@@ -0,0 +1,115 @@
+/*
+ * fwdbench - cost of the winmm exports stubs.c forwards
+ *
+ * A Windows program, built with the DLL's compiler against stubs.c the way
+ * the game calls into it, without linking winmm itself so the first
+ * forwarded call finds the system winmm.dll not yet loaded. Reports:
+ *   - the very first forwarded call, which loads winmm.dll and resolves
+ *     the whole table
+ *   - the first call of another export once the table is there
+ *   - the steady state cost of a forwarded call, next to calling the
+ *     system export directly, with and without ProfileForwards
+ *
+ * usage: fwdbench [calls]
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../stats.h"
+#include "../stubs.h"
+
+/* the thunks are exported through the .def file, not declared anywhere */
+UINT WINAPI fake_mmsystemGetVersion(void);
+DWORD WINAPI fake_timeGetTime(void);
+HINSTANCE getWinmmHandle();
+
+static LARGE_INTEGER freq;
+
+static LONGLONG now()
+{
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return t.QuadPart;
+}
+
+static double ns_since(LONGLONG t0)
+{
+    return (now() - t0) * 1e9 / freq.QuadPart;
+}
+
+/* nanoseconds per call of f, best of a few rounds so a preemption doesn't
+ * count */
+static double per_call(DWORD (WINAPI *f)(void), int calls)
+{
+    double best = 1e30;
+    int round, i;
+
+    for (round = 0; round < 5; round++)
+    {
+        LONGLONG t0 = now();
+        double ns;
+
+        for (i = 0; i < calls; i++)
+            f();
+
+        ns = ns_since(t0) / calls;
+
+        if (ns < best)
+            best = ns;
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    int calls = argc > 1 ? atoi(argv[1]) : 1000000;
+    DWORD (WINAPI *direct)(void);
+    LONGLONG t0;
+    double first, other, fwd, fwd_prof, sys;
+
+    if (calls <= 0)
+    {
+        fprintf(stderr, "usage: fwdbench [calls]\n");
+        return 1;
+    }
+
+    /* the profiled thunks record through stats.c */
+    stat_init();
+    QueryPerformanceFrequency(&freq);
+
+    if (GetModuleHandle("winmm.dll"))
+        fprintf(stderr, "winmm.dll is already loaded, the first call is cheaper than in a game\n");
+
+    t0 = now();
+    fake_mmsystemGetVersion();
+    first = ns_since(t0);
+
+    t0 = now();
+    fake_timeGetTime();
+    other = ns_since(t0);
+
+    direct = (DWORD (WINAPI *)(void))GetProcAddress(getWinmmHandle(), "timeGetTime");
+
+    if (!direct)
+    {
+        fprintf(stderr, "can't find timeGetTime in the system winmm.dll\n");
+        return 1;
+    }
+
+    sys = per_call(direct, calls);
+    fwd = per_call(fake_timeGetTime, calls);
+
+    forward_profile_open();
+    fwd_prof = per_call(fake_timeGetTime, calls);
+
+    printf("%-36s %12.0f ns\n", "first call, loads winmm.dll", first);
+    printf("%-36s %12.0f ns\n", "first call of another export", other);
+    printf("%-36s %12.1f ns\n", "timeGetTime direct", sys);
+    printf("%-36s %12.1f ns %+8.1f ns\n", "timeGetTime forwarded", fwd, fwd - sys);
+    printf("%-36s %12.1f ns %+8.1f ns\n", "timeGetTime forwarded, profiled", fwd_prof, fwd_prof - sys);
+
+    return 0;
+}
@@ -0,0 +1,355 @@
+/*
+ * mcireplay - summarize an MCI trace recorded by ogg-winmm, or replay it
+ *
+ * Enable recording with "Trace=1" in the [Debug] section of wgmus.ini, the
+ * DLL then writes mcitrace.bin into the game's working directory.
+ *
+ * With -r the calls the game made are sent again to the emulator core
+ * playing the given music folder into a simulated sink. The sink runs on a
+ * virtual clock that is moved to each call's recorded time, the player
+ * filling its queue as the blocks end, so the replay takes no longer than
+ * the decoding and gives the same answers on every run. Results and
+ * returned strings that differ from the recording are reported and the
+ * call times in the summary are the core's own.
+ *
+ * usage: mcireplay [-v] [-r music folder [-f|-i] [-w]] mcitrace.bin
+ *
+ * -f scans the music folder in folder mode (PlaybackMode=1).
+ * -i scans it as a disc image, one .ogg and a .cue (PlaybackMode=2).
+ * -w follows changes to the music folder during the replay (WatchMusic=1).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_FORMAT_ONLY
+#include "../trace.h"
+#include "../core.h"
+#include "../catalog.h"
+#include "../os.h"
+#include "../player.h"
+#include "../sink.h"
+#include "../stats.h"
+
+#define MAX_CALLS 64
+
+struct call_stats
+{
+    char name[48];
+    int count;
+    int errors;
+    int cap;
+    uint32_t *dt;
+};
+
+static struct call_stats stats[MAX_CALLS];
+static int num_stats = 0;
+
+static const char *msg_name(uint32_t msg)
+{
+    switch (msg)
+    {
+        case 0x0803: return "MCI_OPEN";
+        case 0x0804: return "MCI_CLOSE";
+        case 0x0806: return "MCI_PLAY";
+        case 0x0807: return "MCI_SEEK";
+        case 0x0808: return "MCI_STOP";
+        case 0x0809: return "MCI_PAUSE";
+        case 0x080A: return "MCI_INFO";
+        case 0x080B: return "MCI_GETDEVCAPS";
+        case 0x080D: return "MCI_SET";
+        case 0x0810: return "MCI_SYSINFO";
+        case 0x0814: return "MCI_STATUS";
+        case 0x0855: return "MCI_RESUME";
+    }
+
+    return "MCI_UNKNOWN";
+}
+
+/* "status cdaudio position track 2" -> "status position" */
+static void string_name(const char *cmd, char *name, size_t size)
+{
+    char verb[16] = "", item[16] = "";
+
+    sscanf(cmd, "%15s %*s %15s", verb, item);
+
+    if (!strcmp(verb, "status") || !strcmp(verb, "set") || !strcmp(verb, "sysinfo"))
+        snprintf(name, size, "%s %s", verb, item);
+    else
+        snprintf(name, size, "%s", verb);
+}
+
+static struct call_stats *find_stats(const char *name)
+{
+    int i;
+
+    for (i = 0; i < num_stats; i++)
+    {
+        if (!strcmp(stats[i].name, name))
+            return &stats[i];
+    }
+
+    if (num_stats == MAX_CALLS)
+        return NULL;
+
+    snprintf(stats[num_stats].name, sizeof stats[num_stats].name, "%s", name);
+    return &stats[num_stats++];
+}
+
+static void add_sample(struct call_stats *s, uint32_t dt, uint32_t result)
+{
+    if (s->count == s->cap)
+    {
+        s->cap = s->cap ? s->cap * 2 : 64;
+        s->dt = realloc(s->dt, s->cap * sizeof *s->dt);
+    }
+
+    s->dt[s->count++] = dt;
+
+    if (result)
+        s->errors++;
+}
+
+static int divergences = 0;
+
+static void replay_notify(HWND hwnd, WPARAM status)
+{
+}
+
+/* until the player waits for the clock, or none plays */
+static void replay_settle()
+{
+    MCI_STATUS_PARMS parms;
+
+    do
+    {
+        memset(&parms, 0, sizeof parms);
+        parms.dwItem = MCI_STATUS_MODE;
+        core_command(MAGIC_DEVICEID, MCI_STATUS, MCI_STATUS_ITEM, (DWORD_PTR)&parms);
+    }
+    while (parms.dwReturn == MCI_MODE_PLAY && !sink_sim_settled(1));
+}
+
+static void diverged(long index, const char *name, uint32_t want, uint32_t got, const char *want_ret, const char *got_ret)
+{
+    divergences++;
+    printf("#%ld %s: recorded %u \"%s\", replayed %u \"%s\"\n", index, name, want, want_ret, got, got_ret);
+}
+
+/* sends one recorded call to the core, returns its duration in microseconds */
+static uint32_t replay(long index, struct trace_record *rec, const char *payload, const char *name)
+{
+    uint64_t t0 = os_ticks();
+    uint32_t dt;
+
+    if (rec->kind == TRACE_STRING)
+    {
+        const char *cmd = payload, *want = payload + strlen(payload) + 1;
+        char ret[256] = "";
+        MCIERROR err = core_string(cmd, ret, sizeof ret, NULL);
+
+        dt = stat_us(os_ticks() - t0);
+
+        /* the DLL records no text for a failed command */
+        if (err)
+            ret[0] = '\0';
+
+        if (err != rec->result || strcmp(ret, want))
+            diverged(index, cmd, rec->result, err, want, ret);
+    }
+    else
+    {
+        union
+        {
+            MCI_GENERIC_PARMS   generic;
+            MCI_OPEN_PARMS      open;
+            MCI_PLAY_PARMS      play;
+            MCI_SEEK_PARMS      seek;
+            MCI_SET_PARMS       set;
+            MCI_STATUS_PARMS    status;
+        } parms;
+        char want_ret[16] = "", got_ret[16] = "";
+        uint32_t got = 0;
+        MCIERROR err;
+
+        memset(&parms, 0, sizeof parms);
+
+        switch (rec->msg)
+        {
+            case MCI_PLAY:   parms.play.dwFrom = rec->arg[0]; parms.play.dwTo = rec->arg[1]; break;
+            case MCI_SEEK:   parms.seek.dwTo = rec->arg[0]; break;
+            case MCI_SET:    parms.set.dwTimeFormat = rec->arg[0]; break;
+            case MCI_STATUS: parms.status.dwItem = rec->arg[1]; parms.status.dwTrack = rec->arg[2]; break;
+        }
+
+        err = core_command(rec->device, rec->msg, rec->flags, (DWORD_PTR)&parms);
+        dt = stat_us(os_ticks() - t0);
+
+        /* the values the call returned through parms */
+        if (rec->msg == MCI_STATUS)
+            got = parms.status.dwReturn;
+        else if (rec->msg == MCI_OPEN)
+            got = parms.open.wDeviceID;
+
+        if (rec->msg == MCI_STATUS || rec->msg == MCI_OPEN)
+        {
+            snprintf(want_ret, sizeof want_ret, "%u", rec->arg[0]);
+            snprintf(got_ret, sizeof got_ret, "%u", got);
+        }
+
+        if (err != rec->result || strcmp(want_ret, got_ret))
+            diverged(index, name, rec->result, err, want_ret, got_ret);
+    }
+
+    return dt;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    struct trace_header hdr;
+    struct trace_record rec;
+    char payload[65536];
+    const char *music = NULL;
+    int verbose = 0, mode = CATALOG_CD, watch = 0, i;
+    long index = 0;
+    FILE *fp;
+
+    while (argc > 2 && argv[1][0] == '-')
+    {
+        if (!strcmp(argv[1], "-v"))
+        {
+            verbose = 1;
+        }
+        else if (!strcmp(argv[1], "-r") && argc > 3)
+        {
+            music = argv[2];
+            argc--;
+            argv++;
+        }
+        else if (!strcmp(argv[1], "-f"))
+        {
+            mode = CATALOG_FOLDER;
+        }
+        else if (!strcmp(argv[1], "-i"))
+        {
+            mode = CATALOG_IMAGE;
+        }
+        else if (!strcmp(argv[1], "-w"))
+        {
+            watch = 1;
+        }
+        else
+        {
+            break;
+        }
+
+        argc--;
+        argv++;
+    }
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: mcireplay [-v] [-r music folder [-f|-i] [-w]] mcitrace.bin\n");
+        return 1;
+    }
+
+    if (music)
+    {
+        static const struct core_host host = { core_command, replay_notify };
+
+        stat_init();
+        plr_init();
+        sink_sim_virtual();
+        core_init(&host);
+        core_scan(music, mode);
+        if (watch && !core_watch())
+            fprintf(stderr, "%s: can't watch the music folder\n", music);
+    }
+
+    fp = fopen(argv[1], "rb");
+
+    if (!fp)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    if (fread(&hdr, sizeof hdr, 1, fp) != 1 || memcmp(hdr.magic, TRACE_MAGIC, sizeof hdr.magic) || hdr.version != TRACE_VERSION)
+    {
+        fprintf(stderr, "%s: not an MCI trace\n", argv[1]);
+        return 1;
+    }
+
+    for (; fread(&rec, sizeof rec, 1, fp) == 1; index++)
+    {
+        char name[48];
+
+        if (rec.len && fread(payload, rec.len, 1, fp) != 1)
+            break;
+
+        payload[rec.len] = '\0';
+
+        if (rec.kind == TRACE_STRING)
+        {
+            const char *cmd = payload, *ret = payload + strlen(payload) + 1;
+
+            string_name(cmd, name, sizeof name);
+
+            if (verbose)
+                printf("%10llu.%03u %*s\"%s\" -> %u \"%s\" (%u us)\n", (unsigned long long)(rec.t_us / 1000), (unsigned)(rec.t_us % 1000), rec.depth * 2, "", cmd, rec.result, ret, rec.dt_us);
+        }
+        else
+        {
+            snprintf(name, sizeof name, "%s", msg_name(rec.msg));
+
+            if (verbose)
+                printf("%10llu.%03u %*s%s flags=%08X args=%u,%u,%u -> %u (%u us)\n", (unsigned long long)(rec.t_us / 1000), (unsigned)(rec.t_us % 1000), rec.depth * 2, "", name, rec.flags, rec.arg[0], rec.arg[1], rec.arg[2], rec.result, rec.dt_us);
+        }
+
+        /* string calls already include the commands they issue */
+        if (rec.depth == 0)
+        {
+            struct call_stats *s = find_stats(name);
+
+            if (music)
+            {
+                /* the player gets to where it was when the game called */
+                sink_sim_run(rec.t_us, replay_settle);
+
+                rec.dt_us = replay(index, &rec, payload, name);
+            }
+
+            if (s)
+                add_sample(s, rec.dt_us, rec.result);
+        }
+    }
+
+    fclose(fp);
+    core_unwatch(1);
+
+    if (music)
+        printf("%ld records replayed, %d diverged\n\n", index, divergences);
+
+    printf("%-24s %8s %6s %8s %8s %8s %8s\n", "call", "count", "errors", "min us", "p50 us", "p99 us", "max us");
+
+    for (i = 0; i < num_stats; i++)
+    {
+        struct call_stats *s = &stats[i];
+
+        qsort(s->dt, s->count, sizeof *s->dt, cmp_u32);
+
+        printf("%-24s %8d %6d %8u %8u %8u %8u\n", s->name, s->count, s->errors,
+            s->dt[0], s->dt[s->count / 2], s->dt[(s->count - 1) * 99 / 100], s->dt[s->count - 1]);
+
+        free(s->dt);
+    }
+
+    return divergences != 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * mixbench - throughput of the software mixer kernels
+ *
+ * Converts and mixes synthetic streams the way the mixer thread does for
+ * one output block, and converts the player's blocks to stereo, and
+ * reports millions of output frames per second.
+ *
+ * usage: mixbench [seconds per case]
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../layout.h"
+#include "../mixkernel.h"
+
+#define OUT_RATE    44100
+#define BLOCK       (OUT_RATE / 50)     /* 20 ms, the balanced latency profile */
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t src[OUT_RATE * 4];
+static int16_t tmp[BLOCK * 2];
+static int32_t acc[BLOCK * 2];
+static int16_t out[BLOCK * 2];
+static double seconds = 1.0;
+
+static void report(const char *name, long frames, double dt)
+{
+    printf("%-36s %10.1f Mframes/s %8.0fx realtime\n", name, frames / dt / 1e6, frames / dt / OUT_RATE);
+}
+
+/* one stream through the converter, wrapping around the source buffer */
+static void bench_convert(const char *name, int channels, int bits, int rate, uint32_t volume)
+{
+    int frame_size = channels * bits / 8, src_frames = sizeof src / frame_size, pos = 0, used;
+    struct mix_conv c;
+    long frames = 0;
+    double t0 = now(), dt;
+
+    mix_conv_init(&c, channels, bits, rate, OUT_RATE);
+    mix_conv_volume(&c, volume);
+
+    do
+    {
+        int i, n = 0;
+
+        for (i = 0; i < 64; i++)
+        {
+            while (n < BLOCK)
+            {
+                n += mix_convert(&c, src + pos * frame_size, src_frames - pos, &used, tmp + n * 2, BLOCK - n);
+                pos = (pos + used) % src_frames;
+            }
+
+            frames += n;
+            n = 0;
+        }
+    } while ((dt = now() - t0) < seconds);
+
+    report(name, frames, dt);
+}
+
+/* one decoded block of the player through the channel layout stage */
+static void bench_layout(const char *name, int in, int out, void (*convert)(const struct layout *, const int16_t *, int16_t *, int))
+{
+    static int16_t dst[BLOCK * LAYOUT_MAX_CHANNELS];
+    struct layout l;
+    long frames = 0;
+    double t0 = now(), dt;
+
+    layout_matrix(&l, in, out);
+
+    do
+    {
+        int i;
+
+        for (i = 0; i < 64; i++)
+            convert(&l, (const int16_t *)src, dst, BLOCK);
+
+        frames += 64 * BLOCK;
+    } while ((dt = now() - t0) < seconds);
+
+    report(name, frames, dt);
+}
+
+/* accumulate 'streams' converted blocks and pack the sum */
+static void bench_mix(const char *name, int streams, void (*accumulate)(int32_t *, const int16_t *, int), void (*pack)(int16_t *, const int32_t *, int))
+{
+    long frames = 0;
+    double t0 = now(), dt;
+
+    do
+    {
+        int i, s;
+
+        for (i = 0; i < 64; i++)
+        {
+            memset(acc, 0, sizeof acc);
+
+            for (s = 0; s < streams; s++)
+                accumulate(acc, tmp, BLOCK * 2);
+
+            pack(out, acc, BLOCK * 2);
+            frames += BLOCK;
+        }
+    } while ((dt = now() - t0) < seconds);
+
+    report(name, frames, dt);
+}
+
+int main(int argc, char **argv)
+{
+    char name[64];
+    int i;
+
+    if (argc > 1)
+        seconds = atof(argv[1]);
+
+    srand(1);
+    for (i = 0; i < sizeof src; i++)
+        src[i] = rand();
+
+    for (i = 0; i < BLOCK * 2; i++)
+        tmp[i] = rand();
+
+    bench_convert("convert s16 stereo 44100", 2, 16, 44100, 0xFFFFFFFF);
+    bench_convert("convert s16 stereo 44100 vol 50%", 2, 16, 44100, 0x80008000);
+    bench_convert("convert s16 mono 22050", 1, 16, 22050, 0xFFFFFFFF);
+    bench_convert("convert u8 mono 11025", 1, 8, 11025, 0xFFFFFFFF);
+    bench_convert("convert s16 stereo 48000", 2, 16, 48000, 0xFFFFFFFF);
+
+    for (i = 1; i <= 8; i *= 2)
+    {
+        snprintf(name, sizeof name, "mix %d streams scalar", i);
+        bench_mix(name, i, mix_accumulate_scalar, mix_pack_scalar);
+
+        mix_kernel_init();
+        snprintf(name, sizeof name, "mix %d streams %s", i, mix_accumulate == mix_accumulate_scalar ? "scalar" : "sse2");
+        bench_mix(name, i, mix_accumulate, mix_pack);
+    }
+
+    layout_kernel_init();
+
+    for (i = 0; i < 3; i++)
+    {
+        static const struct { const char *name; int in, out; } cases[] =
+        {
+            { "5.1 to stereo", 6, 2 },
+            { "mono to stereo", 1, 2 },
+            { "7.1 to stereo", 8, 2 },
+        };
+
+        snprintf(name, sizeof name, "layout %s scalar", cases[i].name);
+        bench_layout(name, cases[i].in, cases[i].out, layout_convert_scalar);
+
+        snprintf(name, sizeof name, "layout %s %s", cases[i].name, layout_convert == layout_convert_scalar ? "scalar" : "sse2");
+        bench_layout(name, cases[i].in, cases[i].out, layout_convert);
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * oggpack - packs a folder of CD mode tracks into music.pak
+ *
+ * Takes the NN.ogg or TrackNN.ogg files of the folder, like CD mode does,
+ * and writes them with their index into one archive. Put the archive in
+ * the music folder in their place; the DLL then starts without opening
+ * any of the streams.
+ *
+ * Every track gets a seek table with a point every -s milliseconds, 500 by
+ * default, 0 leaves the tables out. Every track is also decoded once for
+ * its loudness, on several threads, unless -n is given; the DLL applies
+ * the gains with Normalize=1.
+ *
+ * usage: oggpack [-o music.pak] [-s ms] [-n] music folder
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "../os.h"
+#include "../pack.h"
+
+#define MAX_TRACKS 99
+
+static char *files[MAX_TRACKS + 1];
+static const char *dir;
+
+/* CD mode track number of "NN.ogg" or "TrackNN.ogg", 0 for other names */
+static int track_number(const char *name)
+{
+    if (!strncasecmp(name, "track", 5))
+        name += 5;
+
+    if (!isdigit((unsigned char)name[0]) || !isdigit((unsigned char)name[1]) || strcasecmp(name + 2, ".ogg"))
+        return 0;
+
+    return (name[0] - '0') * 10 + name[1] - '0';
+}
+
+static void add_file(void *ctx, const char *name)
+{
+    int n = track_number(name);
+    char path[1024];
+
+    if (n < 1 || files[n])
+        return;
+
+    snprintf(path, sizeof path, "%s/%s", dir, name);
+    files[n] = strdup(path);
+}
+
+int main(int argc, char **argv)
+{
+    const char *out = PACK_NAME, *list[MAX_TRACKS];
+    int tracks[MAX_TRACKS], count = 0, seek_ms = 500, measure = 1, i;
+
+    while (argc > 2 && argv[1][0] == '-')
+    {
+        if (!strcmp(argv[1], "-n"))
+        {
+            measure = 0;
+            argc--;
+            argv++;
+            continue;
+        }
+
+        if (argc < 4)
+            break;
+
+        if (!strcmp(argv[1], "-o"))
+            out = argv[2];
+        else if (!strcmp(argv[1], "-s"))
+            seek_ms = atoi(argv[2]);
+        else
+            break;
+
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc != 2 || seek_ms < 0)
+    {
+        fprintf(stderr, "usage: oggpack [-o music.pak] [-s ms] [-n] music folder\n");
+        return 1;
+    }
+
+    dir = argv[1];
+
+    if (!os_list_dir(dir, add_file, NULL))
+    {
+        perror(dir);
+        return 1;
+    }
+
+    for (i = 1; i <= MAX_TRACKS; i++)
+    {
+        if (!files[i])
+            continue;
+
+        printf("track %02d  %s\n", i, files[i]);
+        list[count] = files[i];
+        tracks[count++] = i;
+    }
+
+    if (!count)
+    {
+        fprintf(stderr, "%s: no NN.ogg tracks\n", dir);
+        return 1;
+    }
+
+    if (measure)
+        printf("measuring loudness...\n");
+
+    if (!pack_write(out, list, tracks, count, seek_ms, measure))
+    {
+        fprintf(stderr, "%s: can't write the archive, or a track can't be played\n", out);
+        return 1;
+    }
+
+    printf("%d tracks packed into %s\n", count, out);
+
+    for (i = 1; i <= MAX_TRACKS; i++)
+        free(files[i]);
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+int                 trace_enabled   = 0;
+static FILE         *trace_fp       = NULL;
+static CRITICAL_SECTION trace_cs;
+static LARGE_INTEGER trace_freq;
+static LARGE_INTEGER trace_epoch;
+static __thread int trace_depth     = 0;
+
+int trace_open(const char *path)
+{
+    struct trace_header hdr;
+
+    trace_fp = fopen(path, "wb");
+
+    if (!trace_fp)
+        return 0;
+
+    /* batch records in stdio, the file is only read after the game exits */
+    setvbuf(trace_fp, NULL, _IOFBF, 64 * 1024);
+
+    memset(&hdr, 0, sizeof hdr);
+    memcpy(hdr.magic, TRACE_MAGIC, sizeof hdr.magic);
+    hdr.version = TRACE_VERSION;
+    fwrite(&hdr, sizeof hdr, 1, trace_fp);
+
+    InitializeCriticalSection(&trace_cs);
+    QueryPerformanceFrequency(&trace_freq);
+    QueryPerformanceCounter(&trace_epoch);
+
+    trace_enabled = 1;
+    return 1;
+}
+
+void trace_close()
+{
+    if (!trace_enabled)
+        return;
+
+    EnterCriticalSection(&trace_cs);
+    trace_enabled = 0;
+    fclose(trace_fp);
+    trace_fp = NULL;
+    LeaveCriticalSection(&trace_cs);
+
+    DeleteCriticalSection(&trace_cs);
+}
+
+/* split so the multiply can't overflow however long the game runs */
+static uint64_t trace_us(uint64_t ticks)
+{
+    return ticks / trace_freq.QuadPart * 1000000 + ticks % trace_freq.QuadPart * 1000000 / trace_freq.QuadPart;
+}
+
+/* returns the start tick of a call and enters a nesting level */
+uint64_t trace_begin()
+{
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    trace_depth++;
+
+    return now.QuadPart;
+}
+
+static void trace_write(struct trace_record *rec, uint64_t start, const char *payload, int len)
+{
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    trace_depth--;
+
+    rec->depth = trace_depth;
+    rec->len   = len;
+    rec->t_us  = trace_us(start - trace_epoch.QuadPart);
+    rec->dt_us = (uint32_t)trace_us(now.QuadPart - start);
+
+    EnterCriticalSection(&trace_cs);
+    if (trace_fp)
+    {
+        fwrite(rec, sizeof *rec, 1, trace_fp);
+        if (len)
+            fwrite(payload, len, 1, trace_fp);
+    }
+    LeaveCriticalSection(&trace_cs);
+}
+
+/* ret is the game's buffer of ret_size chars, NULL if the command returned
+ * no text */
+void trace_string(uint64_t start, const char *cmd, const char *ret, uint32_t ret_size, uint32_t result)
+{
+    struct trace_record rec;
+    char payload[1024];
+    int cmdlen, retlen;
+
+    memset(&rec, 0, sizeof rec);
+    rec.kind   = TRACE_STRING;
+    rec.result = result;
+
+    if (!ret || !ret_size)
+    {
+        ret = "";
+        ret_size = 1;
+    }
+
+    cmdlen = strnlen(cmd, 511);
+    retlen = strnlen(ret, ret_size < 511 ? ret_size : 511);
+
+    memcpy(payload, cmd, cmdlen);
+    payload[cmdlen] = '\0';
+    memcpy(payload + cmdlen + 1, ret, retlen);
+    payload[cmdlen + 1 + retlen] = '\0';
+
+    trace_write(&rec, start, payload, cmdlen + retlen + 2);
+}
+
+void trace_command(uint64_t start, uint32_t device, uint32_t msg, uint32_t flags, const uint32_t *arg, int nargs, uint32_t result)
+{
+    struct trace_record rec;
+    int i;
+
+    memset(&rec, 0, sizeof rec);
+    rec.kind   = TRACE_COMMAND;
+    rec.result = result;
+    rec.device = device;
+    rec.msg    = msg;
+    rec.flags  = flags;
+
+    for (i = 0; i < nargs && i < 3; i++)
+        rec.arg[i] = arg[i];
+
+    trace_write(&rec, start, NULL, 0);
+}
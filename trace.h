@@ -0,0 +1,52 @@
+/* Binary MCI trace, written by the DLL and read by tools/mcireplay.
+ *
+ * The file is a trace_header followed by trace_records. Each record is
+ * followed by 'len' bytes of payload: for TRACE_STRING the command string and
+ * the returned string, both NUL terminated. All fields are little-endian.
+ */
+
+#include <stdint.h>
+
+#define TRACE_MAGIC     "MCITRACE"
+#define TRACE_VERSION   2
+
+enum trace_kind
+{
+    TRACE_STRING    = 1,    /* mciSendString */
+    TRACE_COMMAND   = 2     /* mciSendCommand */
+};
+
+#pragma pack(push, 1)
+
+struct trace_header
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    reserved;
+};
+
+struct trace_record
+{
+    uint8_t     kind;
+    uint8_t     depth;      /* 0 for calls made by the game, 1 for string -> command */
+    uint16_t    len;        /* payload bytes after the record */
+    uint64_t    t_us;       /* call start, microseconds since the trace was opened */
+    uint32_t    dt_us;      /* time spent in the call */
+    uint32_t    result;     /* MCIERROR */
+    uint32_t    device;
+    uint32_t    msg;
+    uint32_t    flags;
+    uint32_t    arg[3];     /* parms fields after dwCallback, captured on return */
+};
+
+#pragma pack(pop)
+
+#ifndef TRACE_FORMAT_ONLY
+extern int trace_enabled;
+
+int trace_open(const char *path);
+void trace_close();
+uint64_t trace_begin();
+void trace_string(uint64_t start, const char *cmd, const char *ret, uint32_t ret_size, uint32_t result);
+void trace_command(uint64_t start, uint32_t device, uint32_t msg, uint32_t flags, const uint32_t *arg, int nargs, uint32_t result);
+#endif